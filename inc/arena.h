@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+// Owns objects of a single type, constructed one after the other in blocks of
+// contiguous slots. Objects never move, so pointers to them stay valid, and they are
+// all destroyed together with the arena, in reverse order of creation.
+template <typename T, size_t BLOCK = 256> class Arena
+{
+    struct Block
+    {
+        alignas(T) unsigned char storage[BLOCK * sizeof(T)];
+    };
+
+    std::vector<std::unique_ptr<Block>> blocks_;
+    size_t size_ = 0;
+
+  public:
+    Arena() = default;
+    ~Arena() { Clear(); }
+
+    Arena(Arena const &) = delete;
+    void operator=(Arena const &) = delete;
+
+    template <typename... Args> T *Create(Args &&... args)
+    {
+        if (size_ == blocks_.size() * BLOCK)
+            blocks_.push_back(std::make_unique<Block>());
+
+        void *slot = blocks_[size_ / BLOCK]->storage + (size_ % BLOCK) * sizeof(T);
+        T *object = new (slot) T(std::forward<Args>(args)...);
+        size_++;
+        return object;
+    }
+
+    size_t GetSize() const { return size_; }
+
+    void Clear()
+    {
+        while (size_ > 0)
+        {
+            size_--;
+            auto slot = blocks_[size_ / BLOCK]->storage + (size_ % BLOCK) * sizeof(T);
+            std::launder(reinterpret_cast<T *>(slot))->~T();
+        }
+
+        blocks_.clear();
+    }
+};
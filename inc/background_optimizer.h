@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "hinge_model.h"
+#include "racing_line.h"
+#include "triple_buffer.h"
+
+// Optimizes a hinge model continuously on its own thread and publishes a RacingLine
+// copy every optimizations_per_frame steps. The model belongs to the thread while the
+// optimizer exists, everything else reads the published copies.
+//
+// With horizon_hinges set, once a focus is given only that many hinges past it are
+// optimized (receding horizon). The window follows the focus, wrapping around to the
+// start of the lap near its end, and whenever the optimization converges the thread
+// waits for the focus to move instead of pausing.
+class BackgroundOptimizer
+{
+    HingeModel &model_;
+    const int steps_per_snapshot_;
+    const size_t horizon_hinges_;
+
+    TripleBuffer<RacingLine> racing_line_;
+    uint64_t published_;
+
+    std::mutex mutex_;
+    std::condition_variable pause_cv_;
+    bool paused_;
+    bool exit_;
+    size_t focus_;
+    bool waiting_for_focus_;
+
+    std::thread thread_;
+
+    void Loop();
+
+    Log log_{"BackgroundOptimizer"};
+
+  public:
+    // The optimization starts paused, score is the one of the model's current state.
+    BackgroundOptimizer(HingeModel &model, double score);
+    ~BackgroundOptimizer();
+
+    BackgroundOptimizer(BackgroundOptimizer const &) = delete;
+    void operator=(BackgroundOptimizer const &) = delete;
+
+    void SetPaused(bool paused);
+    bool IsPaused();
+
+    // Hinge the car is heading to, the horizon starts right after it.
+    void SetFocus(size_t hinge);
+
+    // Latest published line. Only one thread may read, the returned line stays valid
+    // until the next call.
+    const RacingLine &GetRacingLine();
+};
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+// Symmetric block tridiagonal matrix with BLOCK x BLOCK blocks, solved in linear time
+// by the block version of the Thomas algorithm (a block LDL^T factorization).
+class BlockTridiagonal
+{
+  public:
+    static const size_t BLOCK = 4;
+    using Block = std::array<double, BLOCK * BLOCK>;
+
+  private:
+    // diagonal blocks and the blocks right of them, row major
+    std::vector<Block> diagonal_, upper_;
+
+    // factorization: Cholesky factors of the pivot blocks and pivot^-1 * upper
+    std::vector<Block> pivot_factor_, eliminated_;
+    std::vector<double> work_;
+
+  public:
+    // Resizes to cover at least `size` unknowns and zeroes every entry.
+    void Reset(size_t size);
+    size_t GetSize() const;
+
+    // Adds to entry (row, col) and, unless it's on the diagonal, (col, row). The entry
+    // must lie within the band.
+    void Add(size_t row, size_t col, double value);
+
+    // Factorizes the matrix with `shift` added to its diagonal. Returns false if the
+    // result isn't positive definite.
+    bool Factorize(const std::vector<double> &shift);
+
+    // Solves the factorized system for `rhs`, both have GetSize() entries.
+    void Solve(const std::vector<double> &rhs, std::vector<double> &x);
+};
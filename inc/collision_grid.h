@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Uniform grid of square cells holding line segments, the broadphase of the track
+// boundary checks. The grid is laid over the bounding box of the segments, with cells
+// about twice as long as an average segment, and only the cells some segment's
+// bounding box overlaps are stored. Their segment indices share one flat array
+// (compressed rows): the segments of the k-th stored cell are
+// cell_segments_[cell_start_[k] .. cell_start_[k + 1]). Segment endpoints are kept as
+// structure of arrays, so a cell is tested in one loop.
+class CollisionGrid
+{
+  public:
+    struct Line
+    {
+        double x0, y0, x1, y1;
+    };
+
+  private:
+    double origin_x_, origin_y_, cell_side_;
+    // cells covered by the bounding box of all segments
+    uint32_t width_, height_;
+
+    // position of every stored cell in cell_start_, by Key
+    std::unordered_map<uint64_t, uint32_t> cells_;
+    std::vector<uint32_t> cell_start_, cell_segments_;
+    std::vector<double> x0_, y0_, dx_, dy_;
+
+    static uint64_t Key(uint32_t x, uint32_t y);
+
+    // Range of cells overlapped by the bounding box of the line, clipped to the grid.
+    // Returns false if it misses the grid altogether.
+    bool CellRange(const Line &line, uint32_t &x_first, uint32_t &x_last,
+                   uint32_t &y_first, uint32_t &y_last) const;
+
+  public:
+    CollisionGrid();
+
+    // Replaces the segments held by the grid and lays the grid out anew.
+    void Build(const std::vector<Line> &lines);
+    size_t GetSegmentCount() const;
+    size_t GetCellCount() const;
+
+    // Whether the line crosses any of the segments. Parallel segments never cross.
+    bool Intersects(const Line &line) const;
+};
@@ -9,10 +9,13 @@
 
 class Config
 {
+  public:
+    using Params = std::map<std::string, boost::any>;
+
   private:
     Config();
-    std::map<std::string, boost::any> params_;
-    void LoadXMLConfig(pugi::xml_document &doc);
+    Params params_;
+    static void LoadXMLConfig(pugi::xml_document &doc, Params &params);
 
     Log log_{"Configuration"};
 
@@ -28,14 +31,24 @@ class Config
 
     void Load(std::string config_path);
     void Load(int argc, char **argv);
+    // Applies the file over the given options instead of the loaded ones, returns
+    // false if it can't be parsed.
+    static bool LoadFile(const std::string &config_path, Params &params);
+    const Params &GetParameters() const;
 
     void SetParameter(std::string name, boost::any val);
     void DumpSettings();
 
-    template <typename T> T GetOption(std::string name)
+    template <typename T> T GetOption(std::string name) const
+    {
+        return GetOption<T>(params_, name);
+    }
+
+    template <typename T>
+    static T GetOption(const Params &params, const std::string &name)
     {
-        auto val = params_.find(name);
-        ASSERT(val != params_.end(), "No such option: " + name);
+        auto val = params.find(name);
+        ASSERT(val != params.end(), "No such option: " + name);
         ASSERT(val->second.type() == typeid(T),
                "Requested option " + name + " with type " + typeid(T).name() +
                    " but got " + val->second.type().name());
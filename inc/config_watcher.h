@@ -0,0 +1,68 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+#include "config.h"
+#include "log.h"
+#include "triple_buffer.h"
+
+// Options as they were after one reload of the configuration file, never changed once
+// published.
+struct ConfigSnapshot
+{
+    Config::Params params;
+    // 0 until the file is reloaded for the first time
+    uint64_t version = 0;
+
+    template <typename T> T GetOption(const std::string &name) const
+    {
+        return Config::GetOption<T>(params, name);
+    }
+};
+
+// Watches a configuration file from its own thread by polling its modification time
+// every config_poll_interval milliseconds. Only when the file changes it's parsed, over
+// the options loaded when the watcher was created, and published as a new snapshot, so
+// the reader never touches the file.
+class ConfigWatcher
+{
+    // modification time and size of the file, all zero if there's none
+    struct FileState
+    {
+        int64_t seconds, nanoseconds, size;
+        bool operator==(const FileState &other) const;
+    };
+
+    const std::string path_;
+    const Config::Params base_;
+    const int poll_interval_ms_;
+
+    TripleBuffer<ConfigSnapshot> snapshot_;
+    uint64_t version_;
+
+    std::mutex mutex_;
+    std::condition_variable exit_cv_;
+    bool exit_;
+
+    std::thread thread_;
+
+    static FileState GetFileState(const std::string &path);
+    // the file as it was when the options were loaded
+    void Loop(FileState loaded);
+
+    Log log_{"ConfigWatcher"};
+
+  public:
+    explicit ConfigWatcher(const std::string &path);
+    ~ConfigWatcher();
+
+    ConfigWatcher(ConfigWatcher const &) = delete;
+    void operator=(ConfigWatcher const &) = delete;
+
+    // Latest snapshot. Only one thread may read, the returned snapshot stays valid until
+    // the next call.
+    const ConfigSnapshot &Read();
+};
@@ -1,38 +1,148 @@
 
 #pragma once
 
-#include <pugixml.hpp>
+#include <fstream>
 
 #include "hinge_model.h"
 #include "log.h"
+#include "track_parser.h"
+
+using Track = std::vector<TrackWaypoint>;
+
+// Everything the model is given for one hinge: the points of both bands next to it, its
+// position, width and distance along the track.
+struct HingeGeometry
+{
+    double left_x, left_y, right_x, right_y;
+    double x, y, width, forward;
+};
+
+// Places hinges and band segments along a track one waypoint at a time, so waypoints
+// can be fed straight from the parser. Hinges are placed every
+// band_separation * separation_factor along the track.
+class HingeModelBuilder
+{
+    HingeModel &model_;
+    const float angle_factor_, bound_factor_, forward_factor_, band_separation_;
+
+    float x_, y_, heading_;
+    float fuse_, forward_total_;
+    HingeModel::BandSegement *last_left_band_, *last_right_band_;
+    std::vector<HingeGeometry> geometry_;
+
+  public:
+    HingeModelBuilder(HingeModel &model, Vector<2, false> startpoint,
+                      float separation_factor = 1.0f);
+    void Add(const TrackWaypoint &waypoint);
+    // Adds a hinge placed before, e.g. taken from GetGeometry of another builder.
+    void Add(const HingeGeometry &hinge);
+
+    // of the hinges added so far
+    const std::vector<HingeGeometry> &GetGeometry() const;
+};
 
 class DataReader
 {
   public:
+    // Tracks are read either from TORCS XML files or from binary track files, see
+    // TrackFile, whichever the file turns out to be.
+    static Track ParseTORCSTrack(std::string xml_path);
+
+    // Hinges are placed every band_separation * separation_factor along the track.
+    static void BuildHingeModel(const Track &track, HingeModel &model,
+                                Vector<2, false> startpoint,
+                                float separation_factor = 1.0f);
+    // Same as BuildHingeModel(ParseTORCSTrack(xml_path), ...), without keeping the
+    // waypoints in memory.
     static void ReadTORCSTrack(std::string xml_path, HingeModel &model,
-                               Vector<2, false> startpoint);
+                               Vector<2, false> startpoint,
+                               float separation_factor = 1.0f);
+    // Same as ReadTORCSTrack, but the geometry built is kept in track_cache_path and
+    // reused as long as neither the track file nor the settings shaping it change.
+    static void ReadTORCSTrackCached(std::string xml_path, HingeModel &model,
+                                     Vector<2, false> startpoint,
+                                     float separation_factor = 1.0f);
 
+    // Where a model of the configured track with the given score is saved by default.
+    static std::string DefaultHingeModelPath(double score);
     static void SaveHingeModel(std::string target_path, const HingeModel &model);
+    static void SaveHingeModel(std::string target_path, const RacingLine &racing_line);
+    // Throws if the file was saved for a model with other hinges, e.g. of another track
+    // or built with another band_separation.
     static void ReadHingeModel(std::string target_path, HingeModel &model);
 };
 
+// Records a track as the car drives it. Waypoints are formatted into a buffer which is
+// written to the file whenever it fills up, so memory doesn't grow with the recording
+// and a crash only loses the last few waypoints. The file is completed when the saver
+// is destroyed.
+//
+// Waypoints which the track doesn't need are dropped on the way: the path is integrated
+// like HingeModelBuilder does, and a run of waypoints is replaced by a single straight
+// segment as long as the path and both bounds stay within recording_tolerance of it
+// and it's no longer than recording_max_gap. The waypoints written turn onto the
+// segments, so the kept points are placed exactly where they were recorded. The
+// waypoints HingeModelBuilder places hinges at, and the ones before them, are always
+// kept, so the track gives the same hinges as if it was recorded in full.
 class TrackSaver
 {
-    pugi::xml_document doc_;
-    pugi::xml_node root_node_;
+  public:
+    // buffered bytes written to the file at once
+    static const size_t FLUSH_SIZE = 1 << 14;
+    // most waypoints a segment may replace, bounds the work per waypoint
+    static const size_t MAX_WINDOW = 64;
+
+  private:
+    // point of the integrated path after a waypoint
+    struct Sample
+    {
+        double x, y, heading, distance;
+        float left, right;
+    };
+
+    std::ofstream file_;
     const std::string track_name_;
+    std::string buffer_;
+
+    const float angle_factor_, forward_factor_, band_separation_;
+    const double tolerance_, max_gap_;
+    double heading_, x_, y_, distance_;
+    // distance since the last hinge, counted the way HingeModelBuilder does
+    float fuse_;
 
-    double heading_, x_, y_;
+    // The last point kept, the direction and length of the segment leading to it, and
+    // the points recorded since, the last of which ends the next segment.
+    bool started_;
+    Sample anchor_;
+    double anchor_direction_, anchor_length_;
+    std::vector<Sample> window_;
+    // whether the last point of the window has to be kept
+    bool keep_last_;
+    // the fuse HingeModelBuilder reaches after the anchor, and how much longer than
+    // the path the segment leading to the anchor was written
+    float written_fuse_;
+    double stretch_;
 
     Vector<2, false> v1_ = {{0.0, 0.0}};
     int waypoint_sep_ = 0;
 
     std::vector<Visualisation::Object> objects_;
 
+    // whether a segment from the anchor to the sample can replace the window
+    bool Fits(const Sample &end) const;
+    // writes the anchor, turning onto the segment of the given direction
+    void WriteAnchor(double next_direction);
+    // Writes the anchor and moves it to the last point of the window, fuse is the one
+    // recorded there if a hinge follows.
+    void Advance(bool hinge_next, float fuse);
+    void WriteWaypoint(float forward, float l, float r, float angle);
+    void AppendField(const char *name, float value);
+    void Flush();
+
   public:
     TrackSaver(std::string track_name);
     ~TrackSaver();
     void MarkWaypoint(float forward, float l, float r, float angle, float speed);
 
     void Visualise(std::vector<Visualisation::Object> &objects) const;
-};
\ No newline at end of file
+};
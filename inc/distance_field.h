@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "collision_grid.h"
+
+// Signed distance to the track bounds, sampled on a regular lattice and interpolated
+// bilinearly. Distances are positive on the track and clamped to [-range, range]. Only
+// tiles of the lattice within range of a bound are stored, everywhere else reads as
+// -range, which holds as long as no point of the track is further than range from its
+// bounds.
+class DistanceField
+{
+  public:
+    // samples along the side of a tile, tiles share their last row and column with the
+    // next ones, so interpolating never needs a neighbouring tile
+    static const size_t TILE = 32;
+
+    struct Sample
+    {
+        double distance, gradient_x, gradient_y;
+    };
+
+  private:
+    double spacing_, range_;
+
+    // position of every stored tile in tile_samples_, by the coordinates of the tile
+    std::unordered_map<uint64_t, uint32_t> tiles_;
+    std::vector<float> tile_samples_;
+
+    static uint64_t Key(int64_t tile_x, int64_t tile_y);
+
+  public:
+    DistanceField(double spacing, double range);
+
+    // Replaces the bounds, which are oriented with the track on their left.
+    void Build(const std::vector<CollisionGrid::Line> &bounds);
+    size_t GetTileCount() const;
+
+    // Distance at the point and its derivatives w.r.t. the coordinates.
+    Sample Evaluate(double x, double y) const;
+};
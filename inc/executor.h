@@ -1,8 +1,10 @@
 #pragma once
 
+#include "config_watcher.h"
 #include "data_reader.h"
 #include "hinge_model.h"
 #include "pid_controller.h"
+#include "racing_line.h"
 #include "torcs_integration.h"
 
 class Executor
@@ -35,19 +37,30 @@ class ExecutorRecording : public Executor
 
 class ExecutorRacing : public Executor
 {
-    const HingeModel &model_;
+    const RacingLine *racing_line_;
     TorcsGearbox gearbox_controller_;
     PidController speed_controller_;
     PidController angle_controller_;
     PidController crossposition_controller_;
 
-    HingeModel::Hinge *current_hinge_;
+    size_t current_hinge_;
+
+    // options which may change while racing, see Reconfigure
     double forward_boost_;
+    double cross_safety_margin_;
 
     Log log_{"ExecutorRacing"};
 
   public:
-    ExecutorRacing(const HingeModel &model);
+    ExecutorRacing();
+
+    // The line to follow from now on, it has to outlive the cycles using it.
+    void SetRacingLine(const RacingLine &racing_line);
+    // Takes forward_boost and cross_safety_margin over from a reloaded configuration.
+    void Reconfigure(const ConfigSnapshot &config);
     CarSteers Cycle(const CarState &state, double dt) override;
     void Visualise(std::vector<Visualisation::Object> &objects) const;
+
+    // Hinge of the racing line the car is heading to.
+    size_t GetCurrentHinge() const;
 };
\ No newline at end of file
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+
+// Closed-form evaluation of a single hinge score term. The term only depends on the
+// hinge, its two neighbours and the speed of the next hinge, so its derivatives can be
+// written out by hand and evaluated without recording an adept tape.
+
+namespace hinge_kernel
+{
+template <typename Real> struct BasicStencil
+{
+    Real previous[2], current[2], next[2];
+    Real speed, next_speed;
+};
+
+template <typename Real> struct BasicResult
+{
+    Real score;
+    Real centrifugal_force;
+
+    // derivatives of the score w.r.t. stencil positions and speeds
+    Real d_previous[2], d_current[2], d_next[2];
+    Real d_speed, d_next_speed;
+};
+
+using Stencil = BasicStencil<double>;
+using Result = BasicResult<double>;
+
+Result Evaluate(const Stencil &s, double max_centrifugal_force, double max_acceleration);
+
+// Second derivatives of the score w.r.t. moving the previous, current and next position
+// along the given directions and w.r.t. the speed and the next speed, in that order.
+// Computed exactly by running Evaluate in forward mode.
+void Hessian(const Stencil &s, const double directions[3][2],
+             double max_centrifugal_force, double max_acceleration, double hessian[5][5]);
+
+// Output arrays of a batch evaluation, entry k belongs to the stencil centred at hinge
+// begin + k. Same quantities as Result, in structure of arrays layout.
+template <typename Real> struct BasicBatchOutput
+{
+    Real *score;
+    Real *centrifugal_force;
+    Real *d_previous[2], *d_current[2], *d_next[2];
+    Real *d_speed, *d_next_speed;
+};
+
+using BatchOutput = BasicBatchOutput<double>;
+
+// Evaluates the stencils centred at hinges [begin, end) of a chain whose positions and
+// speeds are given as contiguous arrays. Picks the widest implementation supported by
+// the CPU at runtime. The float versions compute in single precision throughout and
+// fit twice as many stencils into a vector.
+void EvaluateBatch(const double *x, const double *y, const double *speed, size_t begin,
+                   size_t end, double max_centrifugal_force, double max_acceleration,
+                   const BatchOutput &out);
+void EvaluateBatch(const float *x, const float *y, const float *speed, size_t begin,
+                   size_t end, double max_centrifugal_force, double max_acceleration,
+                   const BasicBatchOutput<float> &out);
+
+void EvaluateBatchScalar(const double *x, const double *y, const double *speed,
+                         size_t begin, size_t end, double max_centrifugal_force,
+                         double max_acceleration, const BatchOutput &out);
+void EvaluateBatchScalar(const float *x, const float *y, const float *speed,
+                         size_t begin, size_t end, double max_centrifugal_force,
+                         double max_acceleration, const BasicBatchOutput<float> &out);
+
+// Processes four double or eight float stencils per instruction, only callable if
+// Avx2Supported().
+void EvaluateBatchAvx2(const double *x, const double *y, const double *speed,
+                       size_t begin, size_t end, double max_centrifugal_force,
+                       double max_acceleration, const BatchOutput &out);
+void EvaluateBatchAvx2(const float *x, const float *y, const float *speed, size_t begin,
+                       size_t end, double max_centrifugal_force, double max_acceleration,
+                       const BasicBatchOutput<float> &out);
+
+bool Avx2Supported();
+}
@@ -1,38 +1,28 @@
 #pragma once
 
+#include "arena.h"
+#include "block_tridiagonal.h"
+#include "collision_grid.h"
+#include "distance_field.h"
+#include "hinge_kernel.h"
 #include "model_element.h"
+#include "optimizer.h"
+#include "racing_line.h"
 #include "util.h"
+#include "worker_pool.h"
 
 #include <adept_arrays.h>
-#include <boost/optional.hpp>
-#include <set>
+#include <memory>
 
 class HingeModel : public ModelElement
 {
   public:
     class Segment;
 
-    class HingeCollisionZone : public ModelElement
-    {
-      private:
-        void SetupEquationsThis() override;
-        void ComputeScoreThis(adept::aReal &score) const override;
-        void ApplyGradientThis(double score_normalization) override;
-        void VisualiseThis(std::vector<Visualisation::Object> &objects) const override;
-
-        Vector<2, false> position_;
-        float collision_zone_side_;
-
-        std::set<Segment *> segments_;
-
-      public:
-        HingeCollisionZone(HingeModel *model, Vector<2, false> position_, float side);
-        bool Collides(Segment *seg) const;
-        void RegisterSegment(HingeModel::Segment *segment_);
-    };
-
     class Segment : public ModelElement, public Visualisation::TooltipInterface
     {
+        template <typename... Ts> friend class ElementPasses;
+
         void LinkBackward(Segment *previous);
         void VisualiseThis(std::vector<Visualisation::Object> &objects) const override;
 
@@ -53,45 +43,41 @@ class HingeModel : public ModelElement
         virtual Vector<2, false> GetPosition() const = 0;
     };
 
-    class Hinge : public Segment
+    // Lightweight view of a single hinge. The hinge state itself lives in HingeModel's
+    // contiguous arrays, the view only carries the index.
+    class Hinge : public Visualisation::TooltipInterface
     {
-      private:
-        void SetupEquationsThis() override;
-        void ComputeScoreThis(adept::aReal &score) const override;
-        void ApplyGradientThis(double score_normalization) override;
+        const HingeModel *model_;
+        size_t index_;
 
         std::string GetTooltip() const override;
 
-        static SDL2pp::Color SpeedToColor(double speed);
-
-        const Vector<2, false> zero_position_;
-        mutable Vector<2, true> position_;
-        adept::aReal crossposition_;
-        Vector<2, false> crossposition_vector_;
-
-        adept::aReal speed_;
-        mutable double last_centrifugal_force_;
-        const double width_;
-        const double forward_;
-
       public:
-        Hinge(HingeModel *model, Vector<2, false> position, double width, double forward);
+        Hinge(const HingeModel *model, size_t index);
 
-        void LinkForward(Segment *next) override;
-        Vector<2, false> GetPosition() const override;
+        size_t GetIndex() const;
+        Vector<2, false> GetPosition() const;
         double GetCrossposition() const;
         double GetSpeed() const;
         Vector<2, false> GetCrosspositionVector() const;
         double GetForward() const;
-        Hinge *GetNext() const;
-        Hinge *GetPrevious() const;
-        void SetCrossposition(double new_cp);
-        void SetSpeed(double new_cp);
+        double GetCrosspositionGradient() const;
+        double GetSpeedGradient() const;
     };
 
     class BandSegement : public Segment
     {
+      public:
+        // side of the track the band bounds, seen in the driving direction
+        enum class Side
+        {
+            Left,
+            Right
+        };
+
       private:
+        template <typename... Ts> friend class ElementPasses;
+
         void SetupEquationsThis() override;
         void ComputeScoreThis(adept::aReal &score) const override;
         void ApplyGradientThis(double score_normalization) override;
@@ -99,39 +85,330 @@ class HingeModel : public ModelElement
         std::string GetTooltip() const override;
 
         Vector<2, false> position_;
+        Side side_;
 
       public:
-        BandSegement(HingeModel *model, Vector<2, false> position);
+        // Band segments belong to the model, which creates them by AddBandSegment.
+        BandSegement(HingeModel *model, Vector<2, false> position, Side side);
+        void LinkForward(Segment *next) override;
         Vector<2, false> GetPosition() const override;
     };
 
+    enum class GradientBackend
+    {
+        Adept,
+        Analytic
+    };
+
+    // Arithmetic of the analytic kernel. The hinge state, the gradients and the score
+    // sums stay in double either way.
+    enum class Precision
+    {
+        Double,
+        Float
+    };
+
   private:
-    std::vector<std::vector<HingeCollisionZone *>> collision_zones_;
-    std::pair<int, int> CoordinatesToCollisionZone(Vector<2, false> pos);
+    // Hinge state in chain order, structure of arrays.
+    struct HingeArrays
+    {
+        std::vector<double> zero_x, zero_y;
+        std::vector<double> crossposition_vector_x, crossposition_vector_y;
+        std::vector<double> crossposition, speed;
+        std::vector<double> width, forward;
+
+        std::vector<double> position_x, position_y;
+        std::vector<double> crossposition_gradient, speed_gradient;
+    };
+
+    // Partial result of a parallel gradient evaluation, covering hinges
+    // [first, first + speed_gradient.size()) including the halo.
+    struct GradientChunk
+    {
+        size_t first;
+        double score;
+        std::vector<double> crossposition_gradient, speed_gradient;
+    };
+
+    // Per-stencil contributions of the last evaluation, indexed by the stencil centre,
+    // used to update the score and the gradients by deltas.
+    struct StencilCache
+    {
+        std::vector<double> score;
+        // contributions to the crossposition gradients of hinges i - 1, i and i + 1
+        std::vector<double> crossposition_gradient[3];
+        // contributions to the speed gradients of hinges i and i + 1
+        std::vector<double> speed_gradient[2];
+        std::vector<uint8_t> feasible;
+
+        // hinge state the cached stencils were evaluated with
+        std::vector<double> crossposition, speed;
+
+        // Stencils to evaluate again. Stencils whose hinges only moved within the
+        // tolerance keep their score and gradients, but their feasibility is checked.
+        enum : uint8_t { CLEAN, DRIFTED, DIRTY };
+        std::vector<uint8_t> dirty;
+
+        double total;
+        size_t infeasible_n;
+        int updates;
+    };
+
+    // The elements of the model, its own state lives in the arrays instead. They're
+    // allocated in the order they're added and freed together with the model.
+    Arena<BandSegement> band_segments_;
+    ElementPasses<BandSegement> elements_;
+    // The solid segments are kept in a grid and the hinge edges are checked against it
+    // during the line search. Hinges whose step would make an edge cross the track
+    // bounds stay put, edges which already crossed them at its start may keep doing so.
+    bool boundary_collisions_;
+    std::vector<CollisionGrid::Line> bounds_;
+    CollisionGrid collision_grid_;
+    bool collision_grid_built_;
+    std::vector<uint8_t> edge_crossing_, step_edge_crossing_;
+    std::vector<size_t> pending_edges_;
+    // hinges the bounds have kept in place since the optimizer was last reset
+    std::vector<uint8_t> held_;
+
+    // Hinges closer to the track bounds than the margin are penalized quadratically.
+    // The distances come from a field built from the bounds on first use.
+    double boundary_penalty_;
+    double boundary_margin_;
+    mutable DistanceField distance_field_;
+    mutable bool distance_field_built_;
+    // the penalty's share of the crossposition gradients and its second derivatives
+    std::vector<double> boundary_gradient_, boundary_curvature_;
+    bool edge_crossing_valid_;
 
-    uint32_t width_;
-    uint32_t height_;
-    double collision_zone_side_;
-    double alpha_;
     double max_centrifugal_force_;
     double max_acceleration_;
-    boost::optional<std::pair<double, double>> first_last_score_;
+    double speed_step_scale_;
+    GradientBackend gradient_backend_;
+
+    // With float precision the optimization runs until it converges and then, if
+    // polishing, goes on in double until it converges again.
+    Precision precision_;
+    bool precision_polish_;
+    bool polishing_;
+
+    HingeArrays hinges_;
+    mutable std::vector<double> last_centrifugal_force_;
+    std::vector<Hinge> hinge_views_;
+
+    std::unique_ptr<WorkerPool> workers_;
+    std::vector<GradientChunk> chunks_;
+
+    // score of the last gradient evaluation and whether it was taken inside the barriers
+    double last_score_;
+    bool last_feasible_;
+    // whether the last evaluation belongs to the current hinge state
+    bool evaluated_;
+
+    // The optimizer sees crosspositions followed by speeds, both as one flat vector.
+    // It's created with the model's own learning rate, whatever the configuration says
+    // by the time it's reset.
+    double alpha_;
+    std::unique_ptr<Optimizer> optimizer_;
+    std::vector<double> parameters_, parameter_gradient_;
+
+    // With the "newton" optimizer the steps solve the banded Hessian system instead.
+    // Unknowns are ordered crossposition, speed for every hinge, so a stencil touches
+    // six consecutive unknowns and pairs of hinges make a block tridiagonal matrix.
+    bool newton_;
+    double newton_initial_damping_;
+    double newton_damping_;
+    BlockTridiagonal hessian_;
+    std::vector<double> newton_shift_, newton_rhs_, newton_step_;
+
+    // The step proposed by the optimizer is only taken if it keeps every stencil inside
+    // the barriers and decreases the score enough (Armijo), otherwise it's halved.
+    double line_search_c1_;
+    int line_search_backtracks_;
+    double line_search_max_scale_;
+    double step_scale_;
+    std::vector<double> start_crossposition_, start_speed_;
+    std::vector<double> step_crossposition_, step_speed_;
 
-    Hinge *first_hinge_;
+    // Converged once the gradient vanishes or the score stops improving for a while.
+    double convergence_gradient_norm_;
+    double convergence_relative_improvement_;
+    int convergence_steps_;
+    int stalled_steps_;
+    bool converged_;
+
+    // Incremental evaluation only re-evaluates stencils around hinges which moved by
+    // more than the tolerance since their last evaluation, with a full evaluation
+    // every incremental_refresh_ steps to get rid of the accumulated rounding.
+    double incremental_tolerance_;
+    int incremental_refresh_;
+    StencilCache stencil_cache_;
+
+    // Only hinges [window_first_, window_end_) are optimized, the others keep their
+    // state. Only the stencils around moved hinges are evaluated again, but the scan for
+    // them, the optimizer update, KeepInsideBounds and the gradient norm still go over
+    // every hinge, so steps get cheaper without becoming independent of the track
+    // length. Past the last hinge the window continues from the first one.
+    size_t window_first_, window_end_;
 
     void SetupEquationsThis() override;
     void ComputeScoreThis(adept::aReal &score) const override;
     void ApplyGradientThis(double score_normalization) override;
     void VisualiseThis(std::vector<Visualisation::Object> &objects) const override;
 
-    void AddHinge(Hinge *h);
-    void AddBandSegment(BandSegement *bs);
+    // Scores the stencils centred strictly inside the hinge range [first, first + n),
+    // where crossposition and speed hold the n hinges of that range.
+    adept::aReal HingeScore(size_t first, const std::vector<adept::aReal> &crossposition,
+                            const std::vector<adept::aReal> &speed) const;
+
+    // Both fill the gradients of hinges [first, last) with the derivatives of the
+    // stencils centred strictly inside that range and return their score.
+    double AdeptGradient(adept::Stack &stack, size_t first, size_t last,
+                         double *crossposition_gradient, double *speed_gradient) const;
+    double AnalyticGradient(size_t first, size_t last, double *crossposition_gradient,
+                            double *speed_gradient) const;
+    // Evaluates the stencils centred at [begin, end), at most KERNEL_BLOCK of them, in
+    // the precision in effect.
+    void EvaluateStencils(size_t begin, size_t end,
+                          const hinge_kernel::BatchOutput &out) const;
+    double ChunkedGradient();
+    double IncrementalGradient();
+    void UpdateStencils(size_t begin, size_t end);
+    void CheckStencils(size_t begin, size_t end);
+    void UpdateFeasible(size_t i, double centrifugal_force);
+
+    // True if no stencil exceeds the centrifugal force or acceleration limit, valid
+    // right after a gradient evaluation.
+    bool CheckFeasible() const;
+    double StencilAcceleration(size_t i) const;
+
+    // Slows down the hinges of stencils outside or close to the barriers, valid right
+    // after a gradient evaluation. Returns false if there were none.
+    bool SlowDownInfeasible();
+
+    // Damped Newton step, valid right after a gradient evaluation.
+    void NewtonStep();
+
+    const DistanceField &GetDistanceField() const;
+
+    // Boundary penalty of hinge i and its first and second derivative w.r.t. the
+    // crossposition.
+    double HingePenalty(size_t i, double &gradient, double &curvature) const;
+
+    // Adds the boundary penalty to the crossposition gradients and returns its sum.
+    double BoundaryPenalty();
+
+    // Edge from hinge i to hinge i + 1 at the current crosspositions.
+    CollisionGrid::Line HingeEdge(size_t i) const;
+
+    // Checks every hinge edge against the track bounds.
+    void UpdateEdgeCrossings();
+
+    // Moves the hinges of edges which cross the track bounds, but didn't at the line
+    // search start, back to their start crossposition and marks them as held. Keeps
+    // the crossings of the resulting state in step_edge_crossing_.
+    void KeepInsideBounds();
+
+    // Switches a converged single precision optimization over to double, returns false
+    // if there's nothing left to polish.
+    bool StartPolishing();
+
+    // Called whenever the hinge state is changed from outside the optimization.
+    void StateChanged();
+
+    bool InWindow(size_t i) const;
+    bool HasWindow() const;
+
+    // Norm of the gradient w.r.t. the optimizer parameters, valid right after a gradient
+    // evaluation.
+    double GradientNorm() const;
+
+    // Lets the optimizer propose a step from the line search start and returns the
+    // directional derivative of the score along it.
+    double ProposeStep();
+    // Moves to the line search start plus scale times the proposed step.
+    void MoveAlongStep(double scale);
 
     Log log_{"HingeModel"};
 
   public:
-    HingeModel(uint32_t width, uint32_t height, float collision_zone_side);
-    Hinge *GetFirstHinge() const;
+    // Settings which may differ between models of the same track. By default they're
+    // read from the configuration.
+    struct Hyperparameters
+    {
+        double alpha;
+        double max_centrifugal_force;
+        int optimizer_threads;
+
+        static Hyperparameters FromConfig();
+    };
+
+    HingeModel();
+    explicit HingeModel(const Hyperparameters &hyperparameters);
+    GradientBackend GetGradientBackend() const;
+    // precision the analytic kernel currently evaluates in
+    Precision GetPrecision() const;
+
+    size_t AddHinge(Vector<2, false> position, double width, double forward);
+
+    // Band segments are linked into bands by Segment::LinkForward.
+    BandSegement *AddBandSegment(Vector<2, false> position, BandSegement::Side side);
+    size_t GetHingeCount() const;
+    Hinge GetHinge(size_t index) const;
+
+    const std::vector<double> &GetCrosspositions() const;
+    const std::vector<double> &GetSpeeds() const;
+    const std::vector<double> &GetForwards() const;
+    void SetCrossposition(size_t index, double cp);
+    void SetSpeed(size_t index, double speed);
+    // Sets the crosspositions and speeds of all the hinges at once.
+    void SetState(const double *crosspositions, const double *speeds);
+
+    // Initialises crosspositions and speeds by interpolating those of a model of the same
+    // track with a different hinge separation, matched by the distance along the track.
+    void InterpolateFrom(const HingeModel &other);
+
+    // Slows down hinges until every stencil is safely inside the barriers.
+    void EnforceLimits();
 
-    double Optimize(adept::Stack &stack);
+    // Restricts the following optimization steps to hinges [first, end), the ones
+    // around them stay fixed. An end past the last hinge wraps around to the start of
+    // the lap. SetWindow(0, SIZE_MAX) optimizes the whole chain again.
+    void SetWindow(size_t first, size_t end);
+
+    // Starts the optimization over with a new optimizer of the configured kind.
+    // Otherwise one is created on the first step, or when hinges are added.
+    void ResetOptimizer();
+
+    double ComputeGradient(adept::Stack &stack);
+
+    // Takes one line search step and returns whether the optimization has converged.
+    // Once it has, further calls do nothing until the hinge state is changed.
+    bool Optimize(adept::Stack &stack);
+
+    // Score of the last gradient evaluation, after Optimize the one of the current state.
+    double GetScore() const;
+
+    // Whether the state of the last gradient evaluation was inside the barriers.
+    bool IsFeasible() const;
+
+    void Snapshot(RacingLine &line) const;
+
+    // Draws the track bounds only, they don't change during optimization.
+    void VisualiseBands(std::vector<Visualisation::Object> &objects) const;
+
+    // Passes over the model and its elements, which replace the children of the tree.
+    void SetupEquations() override;
+    void ComputeScore(adept::aReal &score) override;
+    void Visualise(std::vector<Visualisation::Object> &objects) override;
+
+    static SDL2pp::Color SpeedToColor(double speed);
+};
+
+// Band segments only draw themselves.
+template <> struct PassTraits<HingeModel::BandSegement>
+{
+    static constexpr bool setup = false;
+    static constexpr bool score = false;
+    static constexpr bool apply = false;
+    static constexpr bool visualise = true;
 };
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <mutex>
 #include <sstream>
 #include <string>
 
@@ -15,6 +16,9 @@ class LoggingSingleton
     std::vector<spdlog::sink_ptr> sinks_;
     std::vector<std::shared_ptr<spdlog::logger>> handles_;
 
+    // modules log from several threads
+    std::mutex mutex_;
+
   public:
     LoggingSingleton(LoggingSingleton const &) = delete;
     void operator=(LoggingSingleton const &) = delete;
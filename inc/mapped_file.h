@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Read only mapping of a whole file, unmapped when destroyed.
+class MappedFile
+{
+    void *data_;
+    size_t size_;
+
+  public:
+    // Throws if the file can't be opened or is empty.
+    explicit MappedFile(const std::string &path);
+    ~MappedFile();
+
+    MappedFile(MappedFile const &) = delete;
+    void operator=(MappedFile const &) = delete;
+
+    // page aligned
+    const void *GetData() const;
+    size_t GetSize() const;
+};
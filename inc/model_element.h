@@ -21,7 +21,89 @@ class ModelElement
 
   public:
     virtual ~ModelElement() = default;
-    void Visualise(std::vector<Visualisation::Object> &objects);
-    void SetupEquations();
-    void ComputeScore(adept::aReal &score);
-};
\ No newline at end of file
+
+    // Run the pass on the element and its children. Elements which keep others outside
+    // the tree override them to run the passes of those too.
+    virtual void Visualise(std::vector<Visualisation::Object> &objects);
+    virtual void SetupEquations();
+    virtual void ComputeScore(adept::aReal &score);
+};
+
+// Which passes of an element type do anything. ElementPasses skips the others, so
+// specialize it for types with empty passes.
+template <typename T> struct PassTraits
+{
+    static constexpr bool setup = true;
+    static constexpr bool score = true;
+    static constexpr bool apply = true;
+    static constexpr bool visualise = true;
+};
+
+// Flat alternative to the children of a ModelElement for elements of known types. The
+// elements are kept in one contiguous list per type and every pass goes through them
+// type by type, calling their methods directly instead of through the vtable. Types
+// whose pass does nothing according to PassTraits aren't visited at all. The element
+// types have to befriend ElementPasses.
+template <typename... Ts> class ElementPasses
+{
+    std::tuple<std::vector<Ts *>...> lists_;
+
+    template <typename T> void SetupEquations()
+    {
+        if constexpr (PassTraits<T>::setup)
+        {
+            for (T *element : Get<T>())
+                element->T::SetupEquationsThis();
+        }
+    }
+
+    template <typename T> void ComputeScore(adept::aReal &score) const
+    {
+        if constexpr (PassTraits<T>::score)
+        {
+            for (const T *element : Get<T>())
+                element->T::ComputeScoreThis(score);
+        }
+    }
+
+    template <typename T> void ApplyGradient(double score_normalization)
+    {
+        if constexpr (PassTraits<T>::apply)
+        {
+            for (T *element : Get<T>())
+                element->T::ApplyGradientThis(score_normalization);
+        }
+    }
+
+    template <typename T>
+    void Visualise(std::vector<Visualisation::Object> &objects) const
+    {
+        if constexpr (PassTraits<T>::visualise)
+        {
+            for (const T *element : Get<T>())
+                element->T::VisualiseThis(objects);
+        }
+    }
+
+  public:
+    template <typename T> void Add(T *element)
+    {
+        std::get<std::vector<T *>>(lists_).push_back(element);
+    }
+
+    template <typename T> const std::vector<T *> &Get() const
+    {
+        return std::get<std::vector<T *>>(lists_);
+    }
+
+    void SetupEquations() { (SetupEquations<Ts>(), ...); }
+    void ComputeScore(adept::aReal &score) const { (ComputeScore<Ts>(score), ...); }
+    void ApplyGradient(double score_normalization)
+    {
+        (ApplyGradient<Ts>(score_normalization), ...);
+    }
+    void Visualise(std::vector<Visualisation::Object> &objects) const
+    {
+        (Visualise<Ts>(objects), ...);
+    }
+};
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "data_reader.h"
+#include "hinge_model.h"
+
+// Coarse-to-fine initialisation of a hinge model. The racing line shape converges very
+// slowly on a fine chain, so the track is first read with a hinge separation
+// multires_factor^(multires_levels - 1) times larger than configured and optimized.
+// The result is interpolated onto a chain multires_factor times finer, and so on until
+// it ends up in the target model.
+class Multiresolution
+{
+  public:
+    static void WarmStart(const Track &track, Vector<2, false> startpoint,
+                          HingeModel &model, adept::Stack &stack);
+};
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "data_reader.h"
+#include "hinge_model.h"
+
+// Optimizes multistart_models hinge models of the same track concurrently. Each one gets
+// its own alpha, centrifugal force limit and randomly perturbed initial speeds and
+// crosspositions. The lines are then compared under the configured objective and the
+// best one is kept.
+class MultiStart
+{
+  public:
+    // Puts the best line into model, saves it and returns its score.
+    static double Run(const Track &track, Vector<2, false> startpoint, HingeModel &model,
+                      adept::Stack &stack);
+
+    // Scores the candidates under the objective of model, which is of the same track,
+    // and copies the best line inside the limits into it. Returns its index.
+    static size_t SelectBest(const std::vector<std::unique_ptr<HingeModel>> &candidates,
+                             HingeModel &model, adept::Stack &stack);
+};
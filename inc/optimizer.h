@@ -0,0 +1,94 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "log.h"
+
+// Update rule minimising a score over a flat parameter vector. Implementations keep
+// their per-parameter state in contiguous buffers as long as the parameter vector.
+class Optimizer
+{
+  protected:
+    const size_t size_;
+    const double alpha_;
+
+    Optimizer(size_t size, double alpha);
+
+  public:
+    virtual ~Optimizer() = default;
+
+    // Moves parameters, for which the score and its gradient were evaluated, towards a
+    // lower score.
+    virtual void Step(double score, const std::vector<double> &gradient,
+                      std::vector<double> &parameters) = 0;
+
+    size_t GetSize() const;
+
+    // Builds the optimizer selected by the "optimizer" option, with the learning rate
+    // of the "alpha" option unless one is given.
+    static std::unique_ptr<Optimizer> Create(size_t size);
+    static std::unique_ptr<Optimizer> Create(size_t size, double alpha);
+};
+
+class SgdOptimizer : public Optimizer
+{
+  public:
+    SgdOptimizer(size_t size, double alpha);
+    void Step(double score, const std::vector<double> &gradient,
+              std::vector<double> &parameters) override;
+};
+
+class MomentumOptimizer : public Optimizer
+{
+    const double momentum_;
+    std::vector<double> velocity_;
+
+  public:
+    MomentumOptimizer(size_t size, double alpha);
+    void Step(double score, const std::vector<double> &gradient,
+              std::vector<double> &parameters) override;
+};
+
+class AdamOptimizer : public Optimizer
+{
+    const double beta1_, beta2_, epsilon_;
+    double beta1_power_, beta2_power_;
+    std::vector<double> first_moment_, second_moment_;
+
+  public:
+    AdamOptimizer(size_t size, double alpha);
+    void Step(double score, const std::vector<double> &gradient,
+              std::vector<double> &parameters) override;
+};
+
+// Limited memory BFGS. There is a single gradient evaluation per step, so instead of a
+// line search a step that doesn't decrease the score is taken back and retried with
+// half the length along the same direction.
+class LbfgsOptimizer : public Optimizer
+{
+    const size_t history_;
+
+    // last `history_` parameter and gradient differences, one row per pair, used as a
+    // ring buffer
+    std::vector<double> s_, y_;
+    std::vector<double> rho_;
+    size_t pairs_n_, newest_;
+
+    std::vector<double> previous_parameters_, previous_gradient_;
+    std::vector<double> direction_;
+    std::vector<double> coefficients_;
+    double previous_score_;
+    double step_;
+    bool started_;
+
+    void ComputeDirection(const std::vector<double> &gradient);
+
+    Log log_{"LbfgsOptimizer"};
+
+  public:
+    LbfgsOptimizer(size_t size, double alpha);
+    void Step(double score, const std::vector<double> &gradient,
+              std::vector<double> &parameters) override;
+};
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "visualisation.h"
+
+// Copy of the hinge state taken after an optimization step. The racing executor and the
+// visualisation read those copies instead of the model that is being optimized.
+struct RacingLine
+{
+    // Tooltip of a hinge in the copy, refers to the line by address so the line must
+    // not be moved once filled.
+    class Hinge : public Visualisation::TooltipInterface
+    {
+        const RacingLine *line_;
+        size_t index_;
+
+        std::string GetTooltip() const override;
+
+      public:
+        Hinge(const RacingLine *line, size_t index);
+    };
+
+    std::vector<double> forward, crossposition, speed;
+    std::vector<double> position_x, position_y;
+    std::vector<double> crossposition_vector_x, crossposition_vector_y;
+    std::vector<Hinge> hinges;
+
+    double score = 0.0;
+    uint64_t version = 0;
+
+    size_t GetHingeCount() const;
+    Vector<2, false> GetPosition(size_t index) const;
+    Vector<2, false> GetCrosspositionVector(size_t index) const;
+
+    void Visualise(std::vector<Visualisation::Object> &objects) const;
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "mapped_file.h"
+#include "track_parser.h"
+
+// Binary track file: a header followed by one packed record per waypoint, in the byte
+// order of the machine that wrote it. Files are mapped into memory and their records
+// used in place, so loading costs no more than checking the header and the checksum.
+// Files written with the other byte order are rejected, convert them from XML again.
+class TrackFile
+{
+  public:
+    static const uint32_t VERSION = 2;
+    // reads back as 0x04030201 with the other byte order
+    static const uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+    struct Header
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t byte_order;
+        uint32_t record_size;
+        uint32_t reserved;
+        uint64_t waypoints_n;
+        // of the records
+        uint64_t checksum;
+    };
+
+    struct Record
+    {
+        float forward, left, right, angle;
+    };
+
+  private:
+    MappedFile file_;
+    const Record *records_;
+    size_t waypoints_n_;
+
+  public:
+    // Maps the file, throws if it isn't a valid track file.
+    explicit TrackFile(const std::string &path);
+
+    size_t GetWaypointCount() const;
+    TrackWaypoint GetWaypoint(size_t index) const;
+
+    // Whether the file starts like a track file, as opposed to a TORCS XML track.
+    static bool IsTrackFile(const std::string &path);
+    static void Write(const std::string &path, const std::vector<TrackWaypoint> &track);
+};
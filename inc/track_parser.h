@@ -0,0 +1,59 @@
+#pragma once
+
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Single record of a TORCS track, relative to the previous one.
+struct TrackWaypoint
+{
+    float forward, angle, left, right;
+};
+
+// Reads the waypoints of a TORCS track file one by one. The file is read in chunks of
+// fixed size and scanned for the few elements the format has, without building a
+// document, so the memory used doesn't depend on the length of the track.
+class TrackParser
+{
+  public:
+    // chunk read from the file at once, no tag or number may be longer than that
+    static const size_t CHUNK = 1 << 16;
+
+  private:
+    enum class Token
+    {
+        StartTag,
+        EndTag,
+        Text,
+        End
+    };
+
+    std::ifstream file_;
+    const std::string path_;
+
+    // bytes [begin_, end_) of the buffer are read but not parsed yet
+    std::vector<char> buffer_;
+    size_t begin_, end_;
+
+    bool in_track_;
+    bool done_;
+    // a tag like <forward/> is returned as a start tag and then as an end tag
+    bool pending_end_;
+    std::string pending_name_;
+    size_t waypoints_n_;
+
+    // Offset from begin_ of the first c at or after the given one, reading more of the
+    // file as needed. Returns false if the file ends first.
+    bool Find(char c, size_t from, size_t &offset);
+
+    Token NextToken(std::string_view &value);
+    Token NextNonBlank(std::string_view &value);
+    [[noreturn]] void Fail(const std::string &message) const;
+
+  public:
+    explicit TrackParser(const std::string &path);
+
+    // Parses the next waypoint, returns false once the track is over.
+    bool Next(TrackWaypoint &waypoint);
+};
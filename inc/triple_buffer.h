@@ -0,0 +1,42 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Hands the latest value over from a single writer thread to a single reader thread.
+// Neither side ever waits: the writer fills the back buffer and swaps it with the
+// middle one, the reader swaps the middle buffer with its front one whenever something
+// new was published in the meantime.
+template <typename T> class TripleBuffer
+{
+    static const uint8_t INDEX_MASK = 0x3;
+    static const uint8_t FRESH = 0x4;
+
+    T buffers_[3];
+    std::atomic<uint8_t> middle_;
+    uint8_t back_, front_;
+
+  public:
+    TripleBuffer() : middle_(1), back_(0), front_(2) {}
+
+    TripleBuffer(TripleBuffer const &) = delete;
+    void operator=(TripleBuffer const &) = delete;
+
+    // Writer side. The back buffer keeps whatever it held two publications ago, so
+    // containers in it can be refilled without allocating.
+    T &GetBack() { return buffers_[back_]; }
+
+    void Publish()
+    {
+        back_ = middle_.exchange(back_ | FRESH, std::memory_order_acq_rel) & INDEX_MASK;
+    }
+
+    // Reader side. The returned value stays untouched until the next call.
+    const T &Read()
+    {
+        if (middle_.load(std::memory_order_relaxed) & FRESH)
+            front_ = middle_.exchange(front_, std::memory_order_acq_rel) & INDEX_MASK;
+
+        return buffers_[front_];
+    }
+};
@@ -3,6 +3,9 @@
 
 #include <adept_arrays.h>
 #include <boost/any.hpp>
+#include <string>
+#include <string_view>
+#include <vector>
 
 boost::any ParseValue(const std::type_info &type_id, std::string value);
 
@@ -17,4 +20,15 @@ adept::aReal det33(const adept::aMatrix33 &m);
 
 adept::aReal CircumcircleRadius(const Vector<2, true> &p1, const Vector<2, true> &p2,
                                 const Vector<2, true> &p3);
+
+const uint64_t CHECKSUM_SEED = 0xcbf29ce484222325ULL;
+
+// FNV-1a hash of the bytes, to detect corrupted files. Hashes of consecutive pieces
+// are chained by passing the previous hash as the seed.
+uint64_t Checksum(const void *data, size_t size, uint64_t seed = CHECKSUM_SEED);
+
+// Writes the pieces one after another into a temporary file next to the path, then
+// renames it over the path, so readers only ever see the old or the complete new file.
+void WriteFileAtomically(const std::string &path,
+                         const std::vector<std::string_view> &pieces);
 }
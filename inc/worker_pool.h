@@ -0,0 +1,43 @@
+#pragma once
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "log.h"
+
+// Fixed set of worker threads executing batches of indexed tasks. Run() blocks until
+// every task of the batch is done; the calling thread doesn't execute tasks itself, so
+// jobs may rely on thread-local state (e.g. an adept::Stack) owned by the workers.
+class WorkerPool
+{
+    std::vector<std::thread> threads_;
+
+    std::mutex mutex_;
+    std::condition_variable work_cv_;
+    std::condition_variable done_cv_;
+
+    std::function<void(size_t)> job_;
+    size_t tasks_n_;
+    size_t next_task_;
+    size_t tasks_done_;
+    std::exception_ptr error_;
+    bool exit_;
+
+    void WorkerLoop();
+
+    Log log_{"WorkerPool"};
+
+  public:
+    WorkerPool(size_t threads);
+    ~WorkerPool();
+
+    WorkerPool(WorkerPool const &) = delete;
+    void operator=(WorkerPool const &) = delete;
+
+    size_t GetSize() const;
+    void Run(size_t tasks, std::function<void(size_t)> job);
+};
@@ -0,0 +1,121 @@
+#include <cstdint>
+
+#include "background_optimizer.h"
+#include "config.h"
+
+namespace
+{
+const size_t NO_FOCUS = SIZE_MAX;
+}
+
+BackgroundOptimizer::BackgroundOptimizer(HingeModel &model, double score)
+    : model_(model),
+      steps_per_snapshot_(Config::inst().GetOption<int>("optimizations_per_frame")),
+      horizon_hinges_(Config::inst().GetOption<int>("horizon_hinges")), published_(0),
+      paused_(true), exit_(false), focus_(NO_FOCUS), waiting_for_focus_(false)
+{
+    auto &line = racing_line_.GetBack();
+    model_.Snapshot(line);
+    line.score = score;
+    line.version = ++published_;
+    racing_line_.Publish();
+
+    thread_ = std::thread(&BackgroundOptimizer::Loop, this);
+}
+
+BackgroundOptimizer::~BackgroundOptimizer()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        exit_ = true;
+    }
+    pause_cv_.notify_all();
+    thread_.join();
+}
+
+void BackgroundOptimizer::SetPaused(bool paused)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        paused_ = paused;
+    }
+    pause_cv_.notify_all();
+
+    log_.Info() << (paused ? "Optimization paused" : "Optimization resumed");
+}
+
+bool BackgroundOptimizer::IsPaused()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return paused_;
+}
+
+void BackgroundOptimizer::SetFocus(size_t hinge)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (hinge == focus_)
+            return;
+
+        focus_ = hinge;
+        waiting_for_focus_ = false;
+    }
+    pause_cv_.notify_all();
+}
+
+const RacingLine &BackgroundOptimizer::GetRacingLine() { return racing_line_.Read(); }
+
+void BackgroundOptimizer::Loop()
+{
+    // adept keeps the active stack per thread
+    adept::Stack stack;
+
+    while (true)
+    {
+        size_t focus;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            pause_cv_.wait(lock,
+                           [this] { return exit_ || (!paused_ && !waiting_for_focus_); });
+            if (exit_)
+                return;
+
+            focus = focus_;
+        }
+
+        const bool receding = horizon_hinges_ > 0 && focus != NO_FOCUS;
+        if (receding)
+        {
+            // near the finish line the horizon reaches into the next lap
+            const size_t first = (focus + 1) % model_.GetHingeCount();
+            model_.SetWindow(first, first + horizon_hinges_);
+        }
+
+        bool converged = false;
+        for (int i = 0; i < steps_per_snapshot_ && !converged; i++)
+            converged = model_.Optimize(stack);
+
+        if (model_.IsFeasible())
+        {
+            auto &line = racing_line_.GetBack();
+            model_.Snapshot(line);
+            line.score = model_.GetScore();
+            line.version = ++published_;
+            racing_line_.Publish();
+        }
+
+        if (converged && horizon_hinges_ > 0)
+        {
+            // nothing left to do until the car moves on
+            std::lock_guard<std::mutex> lock(mutex_);
+            waiting_for_focus_ = focus == focus_;
+        }
+        else if (converged)
+        {
+            // nothing left to do until the user resumes the optimization
+            std::lock_guard<std::mutex> lock(mutex_);
+            paused_ = true;
+            log_.Info() << "Optimization converged, pausing";
+        }
+    }
+}
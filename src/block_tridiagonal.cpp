@@ -0,0 +1,174 @@
+#include <cmath>
+#include <utility>
+
+#include "block_tridiagonal.h"
+#include "exceptions.h"
+
+namespace
+{
+const size_t B = BlockTridiagonal::BLOCK;
+
+// In place Cholesky factorization, leaves the lower triangular factor.
+bool CholeskyFactor(BlockTridiagonal::Block &m)
+{
+    for (size_t j = 0; j < B; j++)
+    {
+        double d = m[j * B + j];
+        for (size_t k = 0; k < j; k++)
+            d -= m[j * B + k] * m[j * B + k];
+
+        if (!(d > 0.0) || !std::isfinite(d))
+            return false;
+
+        m[j * B + j] = std::sqrt(d);
+        for (size_t i = j + 1; i < B; i++)
+        {
+            double v = m[i * B + j];
+            for (size_t k = 0; k < j; k++)
+                v -= m[i * B + k] * m[j * B + k];
+            m[i * B + j] = v / m[j * B + j];
+        }
+
+        for (size_t i = 0; i < j; i++)
+            m[i * B + j] = 0.0;
+    }
+
+    return true;
+}
+
+// Solves L * L^T * x = v in place, with a stride between the entries of v.
+void CholeskySolve(const BlockTridiagonal::Block &l, double *v, size_t stride = 1)
+{
+    for (size_t i = 0; i < B; i++)
+    {
+        double x = v[i * stride];
+        for (size_t k = 0; k < i; k++)
+            x -= l[i * B + k] * v[k * stride];
+        v[i * stride] = x / l[i * B + i];
+    }
+
+    for (size_t i = B; i-- > 0;)
+    {
+        double x = v[i * stride];
+        for (size_t k = i + 1; k < B; k++)
+            x -= l[k * B + i] * v[k * stride];
+        v[i * stride] = x / l[i * B + i];
+    }
+}
+}
+
+void BlockTridiagonal::Reset(size_t size)
+{
+    const size_t blocks = (size + B - 1) / B;
+
+    Block zero{};
+    diagonal_.assign(blocks, zero);
+    upper_.assign(blocks, zero);
+    pivot_factor_.resize(blocks);
+    eliminated_.resize(blocks);
+}
+
+size_t BlockTridiagonal::GetSize() const { return diagonal_.size() * B; }
+
+void BlockTridiagonal::Add(size_t row, size_t col, double value)
+{
+    if (row / B > col / B)
+        std::swap(row, col);
+
+    const size_t block = row / B;
+    ASSERT(col / B <= block + 1, "Entry outside the band");
+
+    if (col / B == block)
+    {
+        diagonal_[block][(row % B) * B + col % B] += value;
+        if (row != col)
+            diagonal_[block][(col % B) * B + row % B] += value;
+    }
+    else
+    {
+        upper_[block][(row % B) * B + col % B] += value;
+    }
+}
+
+bool BlockTridiagonal::Factorize(const std::vector<double> &shift)
+{
+    ASSERT(shift.size() == GetSize());
+
+    for (size_t k = 0; k < diagonal_.size(); k++)
+    {
+        Block &pivot = pivot_factor_[k];
+        pivot = diagonal_[k];
+        for (size_t i = 0; i < B; i++)
+            pivot[i * B + i] += shift[k * B + i];
+
+        // Schur complement of the previous pivot
+        if (k > 0)
+        {
+            const Block &upper = upper_[k - 1];
+            const Block &eliminated = eliminated_[k - 1];
+
+            for (size_t i = 0; i < B; i++)
+            {
+                for (size_t j = 0; j < B; j++)
+                {
+                    double v = 0.0;
+                    for (size_t r = 0; r < B; r++)
+                        v += upper[r * B + i] * eliminated[r * B + j];
+                    pivot[i * B + j] -= v;
+                }
+            }
+        }
+
+        if (!CholeskyFactor(pivot))
+            return false;
+
+        if (k + 1 < diagonal_.size())
+        {
+            eliminated_[k] = upper_[k];
+            for (size_t j = 0; j < B; j++)
+                CholeskySolve(pivot, eliminated_[k].data() + j, B);
+        }
+    }
+
+    return true;
+}
+
+void BlockTridiagonal::Solve(const std::vector<double> &rhs, std::vector<double> &x)
+{
+    ASSERT(rhs.size() == GetSize());
+    const size_t blocks = diagonal_.size();
+    if (blocks == 0)
+        return;
+
+    // forward elimination leaves pivot^-1 * z in x
+    x = rhs;
+    for (size_t k = 0; k < blocks; k++)
+    {
+        double *z = x.data() + k * B;
+        if (k > 0)
+        {
+            // z_k -= eliminated_{k-1}^T * z_{k-1}, where work_ keeps z_{k-1}
+            const Block &eliminated = eliminated_[k - 1];
+            for (size_t i = 0; i < B; i++)
+            {
+                for (size_t r = 0; r < B; r++)
+                    z[i] -= eliminated[r * B + i] * work_[r];
+            }
+        }
+
+        work_.assign(z, z + B);
+        CholeskySolve(pivot_factor_[k], z);
+    }
+
+    // back substitution
+    for (size_t k = blocks - 1; k-- > 0;)
+    {
+        const Block &eliminated = eliminated_[k];
+        const double *next = x.data() + (k + 1) * B;
+        for (size_t i = 0; i < B; i++)
+        {
+            for (size_t j = 0; j < B; j++)
+                x[k * B + i] -= eliminated[i * B + j] * next[j];
+        }
+    }
+}
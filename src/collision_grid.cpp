@@ -0,0 +1,165 @@
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include "collision_grid.h"
+#include "exceptions.h"
+
+namespace
+{
+// cells per average segment length
+const double CELL_SEGMENTS = 2.0;
+
+// no more cells than that along either side, even for extremely long tracks
+const double MAX_CELLS = 1 << 20;
+}
+
+CollisionGrid::CollisionGrid()
+    : origin_x_(0.0), origin_y_(0.0), cell_side_(1.0), width_(0), height_(0),
+      cell_start_(1, 0)
+{
+}
+
+uint64_t CollisionGrid::Key(uint32_t x, uint32_t y) { return uint64_t(x) << 32 | y; }
+
+bool CollisionGrid::CellRange(const Line &line, uint32_t &x_first, uint32_t &x_last,
+                              uint32_t &y_first, uint32_t &y_last) const
+{
+    const double side = cell_side_;
+    const double x_min = std::floor((std::min(line.x0, line.x1) - origin_x_) / side);
+    const double x_max = std::floor((std::max(line.x0, line.x1) - origin_x_) / side);
+    const double y_min = std::floor((std::min(line.y0, line.y1) - origin_y_) / side);
+    const double y_max = std::floor((std::max(line.y0, line.y1) - origin_y_) / side);
+
+    // also rejects NaNs
+    if (!(x_max >= 0.0 && x_min < width_ && y_max >= 0.0 && y_min < height_))
+        return false;
+
+    x_first = uint32_t(std::max(x_min, 0.0));
+    x_last = uint32_t(std::min(x_max, double(width_ - 1)));
+    y_first = uint32_t(std::max(y_min, 0.0));
+    y_last = uint32_t(std::min(y_max, double(height_ - 1)));
+    return true;
+}
+
+void CollisionGrid::Build(const std::vector<Line> &lines)
+{
+    ASSERT(lines.size() < UINT32_MAX, "Too many segments for the collision grid");
+
+    const size_t n = lines.size();
+    x0_.resize(n);
+    y0_.resize(n);
+    dx_.resize(n);
+    dy_.resize(n);
+    cells_.clear();
+    cell_start_.assign(1, 0);
+    cell_segments_.clear();
+    width_ = height_ = 0;
+
+    double x_min = INFINITY, x_max = -INFINITY, y_min = INFINITY, y_max = -INFINITY;
+    double length = 0.0;
+    for (size_t i = 0; i < n; i++)
+    {
+        const auto &line = lines[i];
+        x0_[i] = line.x0;
+        y0_[i] = line.y0;
+        dx_[i] = line.x1 - line.x0;
+        dy_[i] = line.y1 - line.y0;
+
+        x_min = std::min({x_min, line.x0, line.x1});
+        x_max = std::max({x_max, line.x0, line.x1});
+        y_min = std::min({y_min, line.y0, line.y1});
+        y_max = std::max({y_max, line.y0, line.y1});
+        length += std::hypot(dx_[i], dy_[i]);
+    }
+
+    if (n == 0 || !std::isfinite(x_max - x_min) || !std::isfinite(y_max - y_min))
+        return;
+
+    const double extent = std::max(x_max - x_min, y_max - y_min);
+    cell_side_ = std::max(CELL_SEGMENTS * length / n, extent / MAX_CELLS);
+    if (!(cell_side_ > 0.0))
+        cell_side_ = 1.0;
+
+    origin_x_ = x_min;
+    origin_y_ = y_min;
+    width_ = uint32_t(std::floor((x_max - x_min) / cell_side_)) + 1;
+    height_ = uint32_t(std::floor((y_max - y_min) / cell_side_)) + 1;
+
+    // (cell, segment) pairs sorted by cell give the compressed rows directly
+    std::vector<std::pair<uint64_t, uint32_t>> entries;
+    uint32_t x_first, x_last, y_first, y_last;
+    for (size_t i = 0; i < n; i++)
+    {
+        if (!CellRange(lines[i], x_first, x_last, y_first, y_last))
+            continue;
+
+        for (uint32_t y = y_first; y <= y_last; y++)
+        {
+            for (uint32_t x = x_first; x <= x_last; x++)
+                entries.emplace_back(Key(x, y), uint32_t(i));
+        }
+    }
+
+    std::sort(entries.begin(), entries.end());
+
+    cell_segments_.reserve(entries.size());
+    for (size_t k = 0; k < entries.size(); k++)
+    {
+        if (k > 0 && entries[k].first != entries[k - 1].first)
+            cell_start_.push_back(uint32_t(k));
+        if (k == 0 || entries[k].first != entries[k - 1].first)
+            cells_.emplace(entries[k].first, uint32_t(cell_start_.size() - 1));
+
+        cell_segments_.push_back(entries[k].second);
+    }
+
+    if (!entries.empty())
+        cell_start_.push_back(uint32_t(entries.size()));
+}
+
+size_t CollisionGrid::GetSegmentCount() const { return x0_.size(); }
+
+size_t CollisionGrid::GetCellCount() const { return cells_.size(); }
+
+bool CollisionGrid::Intersects(const Line &line) const
+{
+    uint32_t x_first, x_last, y_first, y_last;
+    if (!CellRange(line, x_first, x_last, y_first, y_last))
+        return false;
+
+    // Same test as HingeModel::Segment::Intersects, p + t * r against q + u * s with
+    // the segment as p, r and the line as q, s, both parameters within [0, 1].
+    const double qx = line.x0, qy = line.y0;
+    const double sx = line.x1 - line.x0, sy = line.y1 - line.y0;
+
+    for (uint32_t y = y_first; y <= y_last; y++)
+    {
+        for (uint32_t x = x_first; x <= x_last; x++)
+        {
+            auto cell = cells_.find(Key(x, y));
+            if (cell == cells_.end())
+                continue;
+
+            // a cell is tested as a whole, without an early exit inside the loop
+            bool hit = false;
+            const uint32_t end = cell_start_[cell->second + 1];
+            for (uint32_t k = cell_start_[cell->second]; k < end; k++)
+            {
+                const uint32_t i = cell_segments_[k];
+                const double px = qx - x0_[i], py = qy - y0_[i];
+                const double denominator = dx_[i] * sy - dy_[i] * sx;
+                const double t = (px * sy - py * sx) / denominator;
+                const double u = (px * dy_[i] - py * dx_[i]) / denominator;
+
+                hit |= std::abs(denominator) > 0.001 && 0.0 <= t && t <= 1.0 &&
+                       0.0 <= u && u <= 1.0;
+            }
+
+            if (hit)
+                return true;
+        }
+    }
+
+    return false;
+}
@@ -19,18 +19,28 @@ Config::Config()
     auto config_file = fs.open("res/default_configuration.xml");
     ASSERT(doc.load_buffer(config_file.begin(), config_file.size()),
            "Couldn't parse default configuration!");
-    LoadXMLConfig(doc);
+    LoadXMLConfig(doc, params_);
 }
 
 void Config::Load(std::string config_path)
 {
-    pugi::xml_document doc;
-    if (doc.load_file(config_path.c_str()))
-        LoadXMLConfig(doc);
-    else
+    if (!LoadFile(config_path, params_))
         log_.Error() << "Couldn't parse configuration";
 }
 
+bool Config::LoadFile(const std::string &config_path, Params &params)
+{
+    // a file caught while it's being rewritten may be empty
+    pugi::xml_document doc;
+    if (!doc.load_file(config_path.c_str()) || !doc.root().child("configuration"))
+        return false;
+
+    LoadXMLConfig(doc, params);
+    return true;
+}
+
+const Config::Params &Config::GetParameters() const { return params_; }
+
 void Config::Load(int argc, char **argv)
 {
     for (int arg_i = 1; arg_i < argc; arg_i++)
@@ -71,7 +81,7 @@ void Config::Load(int argc, char **argv)
     }
 }
 
-void Config::LoadXMLConfig(pugi::xml_document &doc)
+void Config::LoadXMLConfig(pugi::xml_document &doc, Params &params)
 {
     // FIXME: error handling
     for (auto child : doc.root().child("configuration").children())
@@ -94,11 +104,11 @@ void Config::LoadXMLConfig(pugi::xml_document &doc)
         else
         {
             std::string wtf = child.name();
-            ASSERT(params_.find(child.name()) != params_.end());
-            value = ParseValue(params_[child.name()].type(), child.text().as_string());
+            ASSERT(params.find(child.name()) != params.end());
+            value = ParseValue(params[child.name()].type(), child.text().as_string());
         }
 
-        params_[child.name()] = value;
+        params[child.name()] = value;
     }
 }
 
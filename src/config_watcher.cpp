@@ -0,0 +1,77 @@
+#include <chrono>
+#include <sys/stat.h>
+
+#include "config_watcher.h"
+
+bool ConfigWatcher::FileState::operator==(const FileState &other) const
+{
+    return seconds == other.seconds && nanoseconds == other.nanoseconds &&
+           size == other.size;
+}
+
+ConfigWatcher::FileState ConfigWatcher::GetFileState(const std::string &path)
+{
+    struct stat status;
+    if (stat(path.c_str(), &status) != 0)
+        return {0, 0, 0};
+
+    return {int64_t(status.st_mtim.tv_sec), int64_t(status.st_mtim.tv_nsec),
+            int64_t(status.st_size)};
+}
+
+ConfigWatcher::ConfigWatcher(const std::string &path)
+    : path_(path), base_(Config::inst().GetParameters()),
+      poll_interval_ms_(Config::inst().GetOption<int>("config_poll_interval")),
+      version_(0), exit_(false)
+{
+    // the file was loaded along with the other options already
+    thread_ = std::thread(&ConfigWatcher::Loop, this, GetFileState(path_));
+}
+
+ConfigWatcher::~ConfigWatcher()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        exit_ = true;
+    }
+    exit_cv_.notify_all();
+    thread_.join();
+}
+
+void ConfigWatcher::Loop(FileState loaded)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!exit_cv_.wait_for(lock, std::chrono::milliseconds(poll_interval_ms_),
+                              [this] { return exit_; }))
+    {
+        const FileState current = GetFileState(path_);
+        if (current == loaded)
+            continue;
+
+        loaded = current;
+        auto params = base_;
+        // unknown options fail assertions, which don't derive from Exception publicly
+        bool loaded_file = false;
+        try
+        {
+            loaded_file = Config::LoadFile(path_, params);
+        }
+        catch (...)
+        {
+        }
+
+        if (!loaded_file)
+        {
+            log_.Error() << "Couldn't load " << path_ << ", keeping the options";
+            continue;
+        }
+
+        auto &snapshot = snapshot_.GetBack();
+        snapshot.params = std::move(params);
+        snapshot.version = ++version_;
+        snapshot_.Publish();
+        log_.Info() << "Reloaded " << path_;
+    }
+}
+
+const ConfigSnapshot &ConfigWatcher::Read() { return snapshot_.Read(); }
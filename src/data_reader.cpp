@@ -1,125 +1,342 @@
 
+#include <algorithm>
+#include <boost/filesystem.hpp>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
 #include <fstream>
 #include <math.h>
-#include <pugixml.hpp>
 
 #include "config.h"
 #include "data_reader.h"
 #include "exceptions.h"
+#include "mapped_file.h"
+#include "track_file.h"
 #include "util.h"
 
-using namespace pugi;
 using std::to_string;
 
+namespace
+{
+// Calls f with every waypoint of the track, read from a binary track file in place or
+// parsed from a TORCS XML track.
+template <typename F> void ForEachWaypoint(const std::string &path, F f)
+{
+    if (TrackFile::IsTrackFile(path))
+    {
+        TrackFile file(path);
+        for (size_t i = 0; i < file.GetWaypointCount(); i++)
+            f(file.GetWaypoint(i));
+        return;
+    }
+
+    TrackParser parser(path);
+    TrackWaypoint waypoint;
+    while (parser.Next(waypoint))
+        f(waypoint);
+}
+
+// Hinge model file: the header followed by the crosspositions and then the speeds of
+// all the hinges, as doubles in native byte order.
+const char HINGES_MAGIC[8] = {'G', 'K', 'H', 'I', 'N', 'G', 'E', 'S'};
+const uint32_t HINGES_VERSION = 1;
+
+struct HingeFileHeader
+{
+    char magic[8];
+    uint32_t version, reserved;
+    uint64_t hinges_n;
+    // of the hinge geometry and of the settings the model was built with, a model only
+    // fits the hinges it was optimized for
+    uint64_t track_hash, config_fingerprint;
+    // of the crosspositions and speeds
+    uint64_t checksum;
+};
+
+static_assert(sizeof(HingeFileHeader) == 48, "Hinge file header isn't packed");
+
+// Track geometry cache file: the header followed by the geometry of every hinge.
+const char GEOMETRY_MAGIC[8] = {'G', 'K', 'G', 'E', 'O', 'M', 'E', 'T'};
+const uint32_t GEOMETRY_VERSION = 1;
+
+struct GeometryFileHeader
+{
+    char magic[8];
+    uint32_t version, reserved;
+    // of the track file and everything the geometry was built from
+    uint64_t key;
+    uint64_t hinges_n;
+    // of the hinge geometry
+    uint64_t checksum;
+};
+
+static_assert(sizeof(GeometryFileHeader) == 40, "Geometry file header isn't packed");
+static_assert(sizeof(HingeGeometry) == 64, "Hinge geometry isn't packed");
+
+uint64_t TrackHash(const RacingLine &line)
+{
+    const size_t size = line.GetHingeCount() * sizeof(double);
+    uint64_t hash = util::Checksum(line.forward.data(), size);
+    hash = util::Checksum(line.crossposition_vector_x.data(), size, hash);
+    return util::Checksum(line.crossposition_vector_y.data(), size, hash);
+}
+
+uint64_t ConfigFingerprint()
+{
+    uint64_t hash = util::CHECKSUM_SEED;
+    for (auto option :
+         {"angle_factor", "bound_factor", "forward_factor", "band_separation"})
+    {
+        const float value = Config::inst().GetOption<float>(option);
+        hash = util::Checksum(&value, sizeof(value), hash);
+    }
+
+    return hash;
+}
+
+// Reads the geometry cached under the key, returns false if there's none or it's
+// unusable.
+bool ReadGeometry(const std::string &path, uint64_t key, HingeModelBuilder &builder)
+{
+    if (!boost::filesystem::exists(path))
+        return false;
+
+    bool valid = boost::filesystem::file_size(path) >= sizeof(GeometryFileHeader);
+    if (valid)
+    {
+        MappedFile file(path);
+        const auto *header = static_cast<const GeometryFileHeader *>(file.GetData());
+        const auto *hinges = reinterpret_cast<const HingeGeometry *>(header + 1);
+        const size_t size = file.GetSize() - sizeof(GeometryFileHeader);
+
+        valid = std::memcmp(header->magic, GEOMETRY_MAGIC, sizeof(GEOMETRY_MAGIC)) == 0 &&
+                header->version == GEOMETRY_VERSION && header->key == key &&
+                size == header->hinges_n * sizeof(HingeGeometry) &&
+                util::Checksum(hinges, size) == header->checksum;
+
+        for (size_t i = 0; valid && i < header->hinges_n; i++)
+            builder.Add(hinges[i]);
+    }
+
+    if (!valid)
+        Log("DataReader").Warning() << "Ignoring invalid track cache " << path;
+
+    return valid;
+}
+
+void WriteGeometry(const std::string &path, uint64_t key,
+                   const std::vector<HingeGeometry> &hinges)
+{
+    const size_t size = hinges.size() * sizeof(HingeGeometry);
+
+    GeometryFileHeader header;
+    std::memcpy(header.magic, GEOMETRY_MAGIC, sizeof(GEOMETRY_MAGIC));
+    header.version = GEOMETRY_VERSION;
+    header.reserved = 0;
+    header.key = key;
+    header.hinges_n = hinges.size();
+    header.checksum = util::Checksum(hinges.data(), size);
+
+    util::WriteFileAtomically(
+        path, {{reinterpret_cast<const char *>(&header), sizeof(header)},
+               {reinterpret_cast<const char *>(hinges.data()), size}});
+}
+}
+
+Track DataReader::ParseTORCSTrack(std::string xml_path)
+{
+    Track track;
+    ForEachWaypoint(xml_path, [&](const TrackWaypoint &waypoint) {
+        track.push_back(waypoint);
+    });
+
+    return track;
+}
+
+HingeModelBuilder::HingeModelBuilder(HingeModel &model, Vector<2, false> startpoint,
+                                     float separation_factor)
+    : model_(model), angle_factor_(Config::inst().GetOption<float>("angle_factor")),
+      bound_factor_(Config::inst().GetOption<float>("bound_factor")),
+      forward_factor_(Config::inst().GetOption<float>("forward_factor")),
+      band_separation_(Config::inst().GetOption<float>("band_separation") *
+                       separation_factor),
+      x_(startpoint(0, 0)), y_(startpoint(0, 1)), heading_(M_PI_2 / 2.0f), fuse_(0.0f),
+      forward_total_(0.0f), last_left_band_(nullptr), last_right_band_(nullptr)
+{
+}
+
+void HingeModelBuilder::Add(const TrackWaypoint &waypoint)
+{
+    float forward = waypoint.forward;
+    float angle = waypoint.angle;
+    float left = waypoint.left * bound_factor_;
+    float right = waypoint.right * bound_factor_;
+
+    x_ += std::cos(heading_) * forward_factor_ * forward;
+    y_ += std::sin(heading_) * forward_factor_ * forward;
+    heading_ += angle * angle_factor_;
+
+    if (fuse_ > band_separation_)
+    {
+        float lx = x_ + std::cos(heading_ + M_PI / 2.0f) * left;
+        float ly = y_ + std::sin(heading_ + M_PI / 2.0f) * left;
+
+        float rx = x_ + std::cos(heading_ - M_PI / 2.0f) * right;
+        float ry = y_ + std::sin(heading_ - M_PI / 2.0f) * right;
+
+        Add(HingeGeometry{lx, ly, rx, ry, (rx + lx) / 2.0f, (ry + ly) / 2.0f,
+                          (left + right) / 2.0, forward_total_});
+        fuse_ = forward;
+    }
+    else
+    {
+        fuse_ += forward;
+    }
+
+    forward_total_ += forward;
+}
+
+void HingeModelBuilder::Add(const HingeGeometry &hinge)
+{
+    using Side = HingeModel::BandSegement::Side;
+    auto left_band = model_.AddBandSegment(
+        Vector<2, false>({{hinge.left_x, hinge.left_y}}), Side::Left);
+    auto right_band = model_.AddBandSegment(
+        Vector<2, false>({{hinge.right_x, hinge.right_y}}), Side::Right);
+    model_.AddHinge(Vector<2, false>({{hinge.x, hinge.y}}), hinge.width, hinge.forward);
+
+    if (last_left_band_ && last_right_band_)
+    {
+        last_left_band_->LinkForward(left_band);
+        last_right_band_->LinkForward(right_band);
+    }
+
+    last_left_band_ = left_band;
+    last_right_band_ = right_band;
+    geometry_.push_back(hinge);
+}
+
+const std::vector<HingeGeometry> &HingeModelBuilder::GetGeometry() const
+{
+    return geometry_;
+}
+
+void DataReader::BuildHingeModel(const Track &track, HingeModel &model,
+                                 Vector<2, false> startpoint, float separation_factor)
+{
+    Log log{"DataReader"};
+    log.Info() << "Begin hinge model building.";
+
+    HingeModelBuilder builder(model, startpoint, separation_factor);
+    for (const auto &waypoint : track)
+        builder.Add(waypoint);
+
+    log.Info() << "Hinge model building done. " << model.GetHingeCount()
+               << " hinges produced.";
+}
+
 void DataReader::ReadTORCSTrack(std::string xml_path, HingeModel &model,
-                                Vector<2, false> startpoint)
+                                Vector<2, false> startpoint, float separation_factor)
 {
     Log log{"DataReader"};
     log.Info() << "Begin track reading.";
 
-    pugi::xml_document doc;
-    if (!doc.load_file(xml_path.c_str()))
-        throw Exception("Couldn't parse track!");
-
-    const auto angle_factor = Config::inst().GetOption<float>("angle_factor");
-    const auto bound_factor = Config::inst().GetOption<float>("bound_factor");
-    const auto forward_factor = Config::inst().GetOption<float>("forward_factor");
-    const auto band_separation = Config::inst().GetOption<float>("band_separation");
+    HingeModelBuilder builder(model, startpoint, separation_factor);
+    ForEachWaypoint(xml_path,
+                    [&](const TrackWaypoint &waypoint) { builder.Add(waypoint); });
 
-    float x = startpoint(0, 0), y = startpoint(0, 1);
-    float heading = M_PI_2 / 2.0f;
-    float fuse = 0.0f;
-    float forward_total = 0.0f;
-    int hinges_n = 0;
+    log.Info() << "Track reading done. " << model.GetHingeCount() << " hinges produced.";
+}
 
-    HingeModel::BandSegement *first_left_band = nullptr, *first_right_band = nullptr,
-                             *last_left_band = nullptr, *last_right_band = nullptr;
+void DataReader::ReadTORCSTrackCached(std::string xml_path, HingeModel &model,
+                                      Vector<2, false> startpoint,
+                                      float separation_factor)
+{
+    const auto cache_path = Config::inst().GetOption<std::string>("track_cache_path");
+    if (cache_path.empty())
+        return ReadTORCSTrack(xml_path, model, startpoint, separation_factor);
 
-    HingeModel::Hinge *last_hinge = nullptr, *first_hinge = nullptr;
+    Log log{"DataReader"};
 
-    for (auto child : doc.root().child("track").children())
+    // everything the geometry depends on
+    uint64_t key;
     {
-        float forward = child.child("forward").text().as_float();
-        float angle = child.child("angle").text().as_float();
-        float left = child.child("left").text().as_float() * bound_factor;
-        float right = child.child("right").text().as_float() * bound_factor;
+        MappedFile file(xml_path);
+        key = util::Checksum(file.GetData(), file.GetSize(), ConfigFingerprint());
+    }
+    const double start[] = {startpoint(0, 0), startpoint(0, 1), separation_factor};
+    key = util::Checksum(start, sizeof(start), key);
 
-        x += std::cos(heading) * forward_factor * forward;
-        y += std::sin(heading) * forward_factor * forward;
-        heading += angle * angle_factor;
+    char name[32];
+    std::snprintf(name, sizeof(name), "track_%016llx.geometry",
+                  static_cast<unsigned long long>(key));
+    const auto path = cache_path + name;
 
-        if (fuse > band_separation)
-        {
-            ASSERT((std::string)child.name() == "waypoint");
-
-            float lx = x + std::cos(heading + M_PI / 2.0f) * left;
-            float ly = y + std::sin(heading + M_PI / 2.0f) * left;
-
-            float rx = x + std::cos(heading - M_PI / 2.0f) * right;
-            float ry = y + std::sin(heading - M_PI / 2.0f) * right;
-
-            auto left_band =
-                new HingeModel::BandSegement(&model, Vector<2, false>({{lx, ly}}));
-            auto right_band =
-                new HingeModel::BandSegement(&model, Vector<2, false>({{rx, ry}}));
-            auto hinge = new HingeModel::Hinge(
-                &model, Vector<2, false>({{(rx + lx) / 2.0f, (ry + ly) / 2.0f}}),
-                (left + right) / 2.0, forward_total);
-
-            if (!first_left_band && !first_right_band)
-            {
-                first_left_band = left_band;
-                first_right_band = right_band;
-                first_hinge = hinge;
-            }
-            else
-            {
-                last_left_band->LinkForward(left_band);
-                last_right_band->LinkForward(right_band);
-                last_hinge->LinkForward(hinge);
-            }
-
-            last_left_band = left_band;
-            last_right_band = right_band;
-            last_hinge = hinge;
-            fuse = forward;
-
-            hinges_n += 1;
-        }
-        else
-        {
-            fuse += forward;
-        }
+    HingeModelBuilder builder(model, startpoint, separation_factor);
+    if (ReadGeometry(path, key, builder))
+    {
+        log.Info() << "Read " << model.GetHingeCount() << " hinges from track cache "
+                   << path;
+        return;
+    }
 
-        forward_total += forward;
+    ForEachWaypoint(xml_path,
+                    [&](const TrackWaypoint &waypoint) { builder.Add(waypoint); });
+
+    // the model is built either way, the cache only saves building it next time
+    try
+    {
+        WriteGeometry(path, key, builder.GetGeometry());
+    }
+    catch (const Exception &ex)
+    {
+        log.Warning() << "Track built with " << model.GetHingeCount()
+                      << " hinges, but its geometry couldn't be cached: " << ex.what();
+        return;
     }
 
-    // last_left_band->LinkForward(first_left_band);
-    // last_right_band->LinkForward(first_right_band);
-    // last_hinge->LinkForward(first_hinge);
+    log.Info() << "Track built with " << model.GetHingeCount()
+               << " hinges, geometry cached in " << path;
+}
+
+std::string DataReader::DefaultHingeModelPath(double score)
+{
+    auto track_name = Config::inst().GetOption<std::string>("track");
+    std::replace(track_name.begin(), track_name.end(), '/', '_');
 
-    log.Info() << "Track reading done. " << hinges_n << " hinges produced.";
+    return Config::inst().GetOption<std::string>("save_model_path_prefix") + track_name +
+           "_" + std::to_string(score) + ".hinges";
 }
 
 void DataReader::SaveHingeModel(std::string target_path, const HingeModel &model)
 {
-    // FIXME: serialize to xml instead of binary
-    std::ofstream outfile(target_path, std::ios::out | std::ios::binary);
-    ASSERT(outfile.good());
-
-    auto current_hinge = model.GetFirstHinge();
-    auto first_hinge = current_hinge;
-    do
-    {
-        auto cp = current_hinge->GetCrossposition();
-        auto speed = current_hinge->GetSpeed();
+    RacingLine racing_line;
+    model.Snapshot(racing_line);
+    SaveHingeModel(target_path, racing_line);
+}
 
-        outfile.write((const char *)&cp, sizeof(cp));
-        outfile.write((const char *)&speed, sizeof(cp));
-        current_hinge = current_hinge->GetNext();
-    } while (current_hinge && current_hinge != first_hinge);
+void DataReader::SaveHingeModel(std::string target_path, const RacingLine &racing_line)
+{
+    const size_t n = racing_line.GetHingeCount();
+
+    HingeFileHeader header;
+    std::memcpy(header.magic, HINGES_MAGIC, sizeof(HINGES_MAGIC));
+    header.version = HINGES_VERSION;
+    header.reserved = 0;
+    header.hinges_n = n;
+    header.track_hash = TrackHash(racing_line);
+    header.config_fingerprint = ConfigFingerprint();
+    header.checksum = util::Checksum(racing_line.speed.data(), n * sizeof(double),
+                                     util::Checksum(racing_line.crossposition.data(),
+                                                    n * sizeof(double)));
+
+    util::WriteFileAtomically(
+        target_path,
+        {{reinterpret_cast<const char *>(&header), sizeof(header)},
+         {reinterpret_cast<const char *>(racing_line.crossposition.data()),
+          n * sizeof(double)},
+         {reinterpret_cast<const char *>(racing_line.speed.data()), n * sizeof(double)}});
 
-    outfile.close();
     Log("DataReader").Info() << "Saved hinge model to " << target_path;
 }
 
@@ -127,55 +344,183 @@ void DataReader::ReadHingeModel(std::string target_path, HingeModel &model)
 {
     Log("DataReader").Info() << "Reading hinges from " << target_path;
 
-    std::fstream infile(target_path, std::ios::in | std::ios::binary);
-    ASSERT(infile.good(), "Failed to load hinge model!");
-    double cp, speed;
+    MappedFile file(target_path);
+    const auto *header = static_cast<const HingeFileHeader *>(file.GetData());
+    const auto *crosspositions = reinterpret_cast<const double *>(header + 1);
+    const size_t n = model.GetHingeCount();
+    const size_t size = sizeof(HingeFileHeader) + 2 * n * sizeof(double);
+
+    RacingLine geometry;
+    model.Snapshot(geometry);
+
+    std::string error;
+    if (file.GetSize() < sizeof(HingeFileHeader) ||
+        std::memcmp(header->magic, HINGES_MAGIC, sizeof(HINGES_MAGIC)) != 0)
+        error = "not a hinge model file";
+    else if (header->version != HINGES_VERSION)
+        error = "unsupported version " + to_string(header->version);
+    else if (header->config_fingerprint != ConfigFingerprint())
+        error = "saved with different track building settings";
+    else if (header->hinges_n != n)
+        error = to_string(header->hinges_n) + " hinges instead of " + to_string(n);
+    else if (header->track_hash != TrackHash(geometry))
+        error = "saved for a different track";
+    else if (file.GetSize() != size)
+        error = "truncated";
+    else if (util::Checksum(crosspositions, size - sizeof(HingeFileHeader)) !=
+             header->checksum)
+        error = "checksum mismatch";
+
+    if (!error.empty())
+        throw Exception("Couldn't read hinge model " + target_path + ", " + error);
+
+    model.SetState(crosspositions, crosspositions + n);
 
-    auto current_hinge = model.GetFirstHinge();
-    auto first_hinge = current_hinge;
+    Log("DataReader").Info() << "Model reading done.";
+}
 
-    while (true)
-    {
-        infile.read((char *)&cp, sizeof(double));
-        infile.read((char *)&speed, sizeof(double));
+TrackSaver::TrackSaver(std::string track_name)
+    : file_(track_name, std::ios::out | std::ios::binary | std::ios::trunc),
+      track_name_(track_name),
+      angle_factor_(Config::inst().GetOption<float>("angle_factor")),
+      forward_factor_(Config::inst().GetOption<float>("forward_factor")),
+      band_separation_(Config::inst().GetOption<float>("band_separation")),
+      tolerance_(Config::inst().GetOption<float>("recording_tolerance")),
+      max_gap_(Config::inst().GetOption<float>("recording_max_gap")), heading_(0.0),
+      x_(0.0), y_(0.0), distance_(0.0), fuse_(0.0f), started_(false),
+      keep_last_(false), written_fuse_(0.0f), stretch_(0.0)
+{
+    if (!file_.is_open())
+        throw Exception("Couldn't create track " + track_name);
 
-        if (infile.eof())
-            break;
+    buffer_.reserve(FLUSH_SIZE + 256);
+    buffer_ = "<?xml version=\"1.0\"?>\n<track>\n";
+    window_.reserve(MAX_WINDOW);
+}
 
-        ASSERT(current_hinge, "The file cotains too many hinges!");
+void TrackSaver::AppendField(const char *name, float value)
+{
+    // the same digits std::to_string gives
+    char number[64];
+    auto result = std::to_chars(number, number + sizeof(number), value,
+                                std::chars_format::fixed, 6);
+
+    buffer_ += "\t\t<";
+    buffer_ += name;
+    buffer_ += '>';
+    buffer_.append(number, result.ptr);
+    buffer_ += "</";
+    buffer_ += name;
+    buffer_ += ">\n";
+}
 
-        current_hinge->SetCrossposition(cp);
-        current_hinge->SetSpeed(speed);
-        current_hinge = current_hinge->GetNext();
-    }
+void TrackSaver::Flush()
+{
+    file_.write(buffer_.data(), buffer_.size());
+    file_.flush();
+    buffer_.clear();
+}
 
-    ASSERT(!current_hinge || current_hinge == first_hinge,
-           "The file doesn't cotain all the hinges!");
+void TrackSaver::WriteWaypoint(float f, float l, float r, float angle)
+{
+    buffer_ += "\t<waypoint>\n";
+    AppendField("forward", f);
+    AppendField("left", l);
+    AppendField("right", r);
+    AppendField("angle", angle);
+    buffer_ += "\t</waypoint>\n";
+
+    if (buffer_.size() >= FLUSH_SIZE)
+        Flush();
+}
 
-    Log("DataReader").Info() << "Model reading done.";
+bool TrackSaver::Fits(const Sample &end) const
+{
+    const Sample &a = anchor_;
+    const double dx = end.x - a.x, dy = end.y - a.y;
+    const double length = end.distance - a.distance;
+    if (window_.size() >= MAX_WINDOW || length > max_gap_)
+        return false;
+
+    // the bounds next to a point, for the heading they're placed with
+    auto bounds = [](double heading, double left, double right, double x, double y,
+                     double(&out)[4]) {
+        out[0] = x - std::sin(heading) * left;
+        out[1] = y + std::cos(heading) * left;
+        out[2] = x + std::sin(heading) * right;
+        out[3] = y - std::cos(heading) * right;
+    };
+
+    auto deviation = [&](const Sample &s, double heading, double left, double right,
+                         double x, double y) {
+        double recorded[4], replaced[4];
+        bounds(s.heading, s.left, s.right, s.x, s.y, recorded);
+        bounds(heading, left, right, x, y, replaced);
+
+        double largest = std::hypot(x - s.x, y - s.y);
+        for (int i = 0; i < 4; i += 2)
+        {
+            largest = std::max(largest, std::hypot(replaced[i] - recorded[i],
+                                                   replaced[i + 1] - recorded[i + 1]));
+        }
+        return largest;
+    };
+
+    // the anchor's bounds turn with the segment leaving it
+    const double direction = std::atan2(dy, dx);
+    if (deviation(a, direction, a.left, a.right, a.x, a.y) > tolerance_)
+        return false;
+
+    // points in between are interpolated along the segment
+    for (const auto &s : window_)
+    {
+        const double t = length > 0.0 ? (s.distance - a.distance) / length : 0.0;
+        if (deviation(s, direction, a.left + t * (end.left - a.left),
+                      a.right + t * (end.right - a.right), a.x + t * dx,
+                      a.y + t * dy) > tolerance_)
+            return false;
+    }
+
+    return true;
 }
 
-TrackSaver::TrackSaver(std::string track_name)
-    : track_name_(track_name), heading_(0.0), x_(0.0), y_(0.0)
+void TrackSaver::WriteAnchor(double next_direction)
 {
-    root_node_ = doc_.append_child("track");
+    // the heading difference is in (-pi, pi] unless the car turned on the spot
+    double turn = std::remainder(next_direction - anchor_direction_, 2.0 * M_PI);
+    WriteWaypoint(anchor_length_ / forward_factor_, anchor_.left, anchor_.right,
+                  turn / angle_factor_);
+    anchor_direction_ = next_direction;
 }
 
-void TrackSaver::MarkWaypoint(float f, float l, float r, float angle, float speed)
+void TrackSaver::Advance(bool hinge_next, float fuse)
 {
-    auto w = root_node_.append_child("waypoint");
-    w.append_child("forward")
-        .append_child(pugi::node_pcdata)
-        .set_value(to_string(f).c_str());
-    w.append_child("left").append_child(node_pcdata).set_value(to_string(l).c_str());
-    w.append_child("right").append_child(node_pcdata).set_value(to_string(r).c_str());
-    w.append_child("angle").append_child(node_pcdata).set_value(to_string(angle).c_str());
+    const Sample &end = window_.back();
+    WriteAnchor(std::atan2(end.y - anchor_.y, end.x - anchor_.x));
+
+    // Segments are a little shorter than the path they replace, so the builder's fuse
+    // falls behind the recorded one. The segment before a hinge makes up for it and
+    // the next one gives it back, which moves a single point by as much.
+    double forward =
+        std::hypot(end.x - anchor_.x, end.y - anchor_.y) / forward_factor_ - stretch_;
+    stretch_ = 0.0;
+    if (hinge_next)
+    {
+        stretch_ = fuse - written_fuse_ - forward;
+        forward += stretch_;
+    }
 
-    const auto angle_factor = Config::inst().GetOption<float>("angle_factor");
-    const auto forward_factor = Config::inst().GetOption<float>("forward_factor");
+    const bool written_hinge = written_fuse_ > band_separation_;
+    written_fuse_ = written_hinge ? float(forward) : written_fuse_ + float(forward);
+    anchor_length_ = forward * forward_factor_;
+    anchor_ = end;
+}
 
-    x_ += std::cos(heading_) * forward_factor * f;
-    y_ += std::sin(heading_) * forward_factor * f;
+void TrackSaver::MarkWaypoint(float f, float l, float r, float angle, float speed)
+{
+    x_ += std::cos(heading_) * forward_factor_ * f;
+    y_ += std::sin(heading_) * forward_factor_ * f;
+    distance_ += forward_factor_ * f;
 
     if (waypoint_sep_++ % 120 == 0)
     {
@@ -187,7 +532,44 @@ void TrackSaver::MarkWaypoint(float f, float l, float r, float angle, float spee
         v1_ = v2;
     }
 
-    heading_ += angle * angle_factor;
+    // the first waypoint moves along the initial heading, it's kept as recorded
+    const double direction = heading_;
+    heading_ += angle * angle_factor_;
+
+    if (tolerance_ <= 0.0)
+    {
+        WriteWaypoint(f, l, r, angle);
+        return;
+    }
+
+    const float fuse = fuse_;
+    const bool hinge = fuse > band_separation_;
+    fuse_ = hinge ? f : fuse + f;
+
+    const Sample sample = {x_, y_, heading_, distance_, l, r};
+    if (!started_)
+    {
+        started_ = true;
+        anchor_ = sample;
+        anchor_direction_ = direction;
+        anchor_length_ = forward_factor_ * f;
+        written_fuse_ = f;
+        return;
+    }
+
+    // The next recorded waypoint always fits, it continues along the anchor's heading.
+    // The points on both sides of the last step before a hinge are kept, so that the
+    // builder places the hinge at the same point.
+    if (window_.empty() || (!keep_last_ && !hinge && Fits(sample)))
+    {
+        window_.push_back(sample);
+        keep_last_ = hinge;
+        return;
+    }
+
+    Advance(hinge, fuse);
+    window_.assign(1, sample);
+    keep_last_ = hinge;
 }
 
 void TrackSaver::Visualise(std::vector<Visualisation::Object> &objects) const
@@ -197,6 +579,13 @@ void TrackSaver::Visualise(std::vector<Visualisation::Object> &objects) const
 
 TrackSaver::~TrackSaver()
 {
-    doc_.save_file(track_name_.c_str());
+    // the last point recorded is kept, as well as its heading
+    if (started_ && !window_.empty())
+        Advance(false, 0.0f);
+    if (started_)
+        WriteAnchor(anchor_.heading);
+
+    buffer_ += "</track>\n";
+    Flush();
     Log("TrackSaver").Info() << "Track saved to: " << track_name_;
-}
\ No newline at end of file
+}
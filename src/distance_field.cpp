@@ -0,0 +1,151 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "distance_field.h"
+#include "exceptions.h"
+
+namespace
+{
+const size_t T = DistanceField::TILE;
+const int64_t T64 = T;
+const size_t TILE_SAMPLES = (T + 1) * (T + 1);
+}
+
+DistanceField::DistanceField(double spacing, double range)
+    : spacing_(spacing), range_(range)
+{
+    ASSERT(spacing > 0.0 && range > 0.0, "Invalid distance field resolution");
+}
+
+uint64_t DistanceField::Key(int64_t tile_x, int64_t tile_y)
+{
+    return uint64_t(uint32_t(tile_x)) << 32 | uint32_t(tile_y);
+}
+
+void DistanceField::Build(const std::vector<CollisionGrid::Line> &bounds)
+{
+    tiles_.clear();
+    tile_samples_.clear();
+
+    // Tiles touched by the bounding box of a bound grown by the range, including their
+    // shared edges, so all copies of a sample see the same bounds. Returns false for
+    // bounds which aren't finite.
+    auto tile_range = [this](const CollisionGrid::Line &line, int64_t &x_first,
+                             int64_t &x_last, int64_t &y_first, int64_t &y_last) {
+        const double side = spacing_ * T;
+        const double x_min = std::ceil((std::min(line.x0, line.x1) - range_) / side - 1);
+        const double x_max = std::floor((std::max(line.x0, line.x1) + range_) / side);
+        const double y_min = std::ceil((std::min(line.y0, line.y1) - range_) / side - 1);
+        const double y_max = std::floor((std::max(line.y0, line.y1) + range_) / side);
+
+        if (!std::isfinite(x_max - x_min) || !std::isfinite(y_max - y_min))
+            return false;
+
+        x_first = int64_t(x_min);
+        x_last = int64_t(x_max);
+        y_first = int64_t(y_min);
+        y_last = int64_t(y_max);
+        return true;
+    };
+
+    int64_t x_first, x_last, y_first, y_last;
+    for (const auto &line : bounds)
+    {
+        if (!tile_range(line, x_first, x_last, y_first, y_last))
+            continue;
+
+        for (int64_t ty = y_first; ty <= y_last; ty++)
+        {
+            for (int64_t tx = x_first; tx <= x_last; tx++)
+            {
+                const uint32_t index = uint32_t(tiles_.size());
+                if (tiles_.emplace(Key(tx, ty), index).second)
+                    tile_samples_.resize(tile_samples_.size() + TILE_SAMPLES);
+            }
+        }
+    }
+
+    // Every sample takes the sign of its closest bound. Where two bounds are equally
+    // close, e.g. around a shared endpoint, the one whose line is further decides.
+    std::vector<double> closest(tile_samples_.size(),
+                                std::numeric_limits<double>::infinity());
+    std::vector<double> line_distance(tile_samples_.size(), 0.0);
+
+    for (const auto &line : bounds)
+    {
+        const double dx = line.x1 - line.x0, dy = line.y1 - line.y0;
+        const double length2 = dx * dx + dy * dy;
+        if (!(length2 > 0.0) || !tile_range(line, x_first, x_last, y_first, y_last))
+            continue;
+
+        for (int64_t ty = y_first; ty <= y_last; ty++)
+        {
+            for (int64_t tx = x_first; tx <= x_last; tx++)
+            {
+                const size_t offset = tiles_.at(Key(tx, ty)) * TILE_SAMPLES;
+                const int64_t first_x = tx * T64, first_y = ty * T64;
+                for (size_t j = 0; j <= T; j++)
+                {
+                    for (size_t i = 0; i <= T; i++)
+                    {
+                        const double px = (first_x + int64_t(i)) * spacing_ - line.x0;
+                        const double py = (first_y + int64_t(j)) * spacing_ - line.y0;
+                        const double t =
+                            std::min(std::max((px * dx + py * dy) / length2, 0.0), 1.0);
+                        const double distance = std::hypot(px - t * dx, py - t * dy);
+                        const double side = (dx * py - dy * px) / std::sqrt(length2);
+
+                        const size_t s = offset + j * (T + 1) + i;
+                        if (distance < closest[s] ||
+                            (distance == closest[s] &&
+                             std::abs(side) > std::abs(line_distance[s])))
+                        {
+                            closest[s] = distance;
+                            line_distance[s] = side;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // beyond the range everything counts as off the track, like the tiles left out
+    for (size_t s = 0; s < tile_samples_.size(); s++)
+    {
+        if (!(closest[s] < range_))
+            tile_samples_[s] = float(-range_);
+        else
+            tile_samples_[s] = float(line_distance[s] > 0.0 ? closest[s] : -closest[s]);
+    }
+}
+
+size_t DistanceField::GetTileCount() const { return tiles_.size(); }
+
+DistanceField::Sample DistanceField::Evaluate(double x, double y) const
+{
+    const Sample far = {-range_, 0.0, 0.0};
+
+    const double gx = std::floor(x / spacing_), gy = std::floor(y / spacing_);
+    if (!std::isfinite(gx) || !std::isfinite(gy))
+        return far;
+
+    const int64_t tx = int64_t(std::floor(gx / T)), ty = int64_t(std::floor(gy / T));
+    auto tile = tiles_.find(Key(tx, ty));
+    if (tile == tiles_.end())
+        return far;
+
+    // lattice cell of the point within the tile
+    const int64_t ix = std::min<int64_t>(int64_t(gx) - tx * T64, T - 1);
+    const int64_t iy = std::min<int64_t>(int64_t(gy) - ty * T64, T - 1);
+    const float *s =
+        tile_samples_.data() + tile->second * TILE_SAMPLES + iy * (T + 1) + ix;
+    const double f00 = s[0], f10 = s[1], f01 = s[T + 1], f11 = s[T + 2];
+    const double fx = x / spacing_ - double(tx * T64 + ix);
+    const double fy = y / spacing_ - double(ty * T64 + iy);
+
+    return {(1.0 - fy) * ((1.0 - fx) * f00 + fx * f10) +
+                fy * ((1.0 - fx) * f01 + fx * f11),
+            ((1.0 - fy) * (f10 - f00) + fy * (f11 - f01)) / spacing_,
+            ((1.0 - fx) * (f01 - f00) + fx * (f11 - f10)) / spacing_};
+}
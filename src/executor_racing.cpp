@@ -2,8 +2,8 @@
 #include "config.h"
 #include "executor.h"
 
-ExecutorRacing::ExecutorRacing(const HingeModel &model)
-    : model_(model),
+ExecutorRacing::ExecutorRacing()
+    : racing_line_(nullptr),
       speed_controller_(Config::inst().GetOption<float>("driver_speed_p"),
                         Config::inst().GetOption<float>("driver_speed_i"),
                         Config::inst().GetOption<float>("driver_speed_d"), -0.4, 1.0),
@@ -14,57 +14,66 @@ ExecutorRacing::ExecutorRacing(const HingeModel &model)
                                 Config::inst().GetOption<float>("driver_cross_i"),
                                 Config::inst().GetOption<float>("driver_cross_d"), -1.0,
                                 1.0),
-      current_hinge_(model_.GetFirstHinge()),
-      forward_boost_(Config::inst().GetOption<float>("forward_boost"))
+      current_hinge_(0),
+      forward_boost_(Config::inst().GetOption<float>("forward_boost")),
+      cross_safety_margin_(Config::inst().GetOption<float>("cross_safety_margin"))
 {
     log_.Info() << "Created racing executor.";
 }
 
+void ExecutorRacing::SetRacingLine(const RacingLine &racing_line)
+{
+    racing_line_ = &racing_line;
+}
+
+void ExecutorRacing::Reconfigure(const ConfigSnapshot &config)
+{
+    forward_boost_ = config.GetOption<float>("forward_boost");
+    cross_safety_margin_ = config.GetOption<float>("cross_safety_margin");
+}
+
 CarSteers ExecutorRacing::Cycle(const CarState &state, double dt)
 {
-    // refresh configuration
-    auto config_path = Config::inst().GetOption<std::string>("config");
-    if (config_path != "")
-    {
-        Config::inst().Load(config_path);
-    }
+    ASSERT(racing_line_, "No racing line to follow");
 
     CarSteers ret;
-    double corrected_forward =
-        state.absolute_odometer + Config::inst().GetOption<float>("forward_boost");
+    double corrected_forward = state.absolute_odometer + forward_boost_;
+
+    const auto &forwards = racing_line_->forward;
+    const auto &speeds = racing_line_->speed;
+    const auto &crosspositions = racing_line_->crossposition;
+    const size_t hinges_n = racing_line_->GetHingeCount();
 
-    while (corrected_forward > current_hinge_->GetForward())
+    while (corrected_forward > forwards[current_hinge_])
     {
-        auto next = current_hinge_->GetNext();
-        if (next)
+        if (current_hinge_ + 1 < hinges_n)
         {
-            current_hinge_ = current_hinge_->GetNext();
+            current_hinge_ += 1;
         }
         else
         {
-            current_hinge_ = model_.GetFirstHinge();
+            current_hinge_ = 0;
             log_.Info() << "Lap completed";
             break;
         }
     }
 
-    double target_speed = current_hinge_->GetSpeed();
-    for (std::pair<HingeModel::Hinge *, int> p = {current_hinge_, 0};
-         p.first->GetNext() && p.second < 3; p.second += 1)
+    double target_speed = speeds[current_hinge_];
+    for (size_t i = current_hinge_; i + 1 < hinges_n && i < current_hinge_ + 3; i++)
     {
-        target_speed = p.first->GetSpeed();
-        p.first = p.first->GetNext();
+        target_speed = speeds[i];
     }
 
     double target_crossposition, target_angle;
 
-    if (auto previous_hinge = current_hinge_->GetPrevious())
+    if (current_hinge_ > 0)
     {
-        auto v_separation = current_hinge_->GetForward() - previous_hinge->GetForward();
+        const size_t previous_hinge = current_hinge_ - 1;
+        auto v_separation = forwards[current_hinge_] - forwards[previous_hinge];
         auto h_separation =
-            current_hinge_->GetCrossposition() - previous_hinge->GetCrossposition();
+            crosspositions[current_hinge_] - crosspositions[previous_hinge];
 
-        auto forward_from_prev = corrected_forward - previous_hinge->GetForward();
+        auto forward_from_prev = corrected_forward - forwards[previous_hinge];
         auto curr_closeness = forward_from_prev / v_separation;
 
         target_angle = std::atan2(h_separation, v_separation);
@@ -72,20 +81,19 @@ CarSteers ExecutorRacing::Cycle(const CarState &state, double dt)
         ASSERT(curr_closeness >= 0.0);
         ASSERT(curr_closeness <= 1.0);
 
-        target_crossposition =
-            curr_closeness * current_hinge_->GetCrossposition() +
-            (1.0 - curr_closeness) * previous_hinge->GetCrossposition();
+        target_crossposition = curr_closeness * crosspositions[current_hinge_] +
+                               (1.0 - curr_closeness) * crosspositions[previous_hinge];
 
         ASSERT(target_crossposition >= -1.0);
         ASSERT(target_crossposition <= 1.0);
     }
     else
     {
-        target_crossposition = current_hinge_->GetCrossposition();
+        target_crossposition = crosspositions[current_hinge_];
         target_angle = 0.0;
     }
 
-    target_crossposition *= Config::inst().GetOption<float>("cross_safety_margin");
+    target_crossposition *= cross_safety_margin_;
 
     ret.gas = speed_controller_.Cycle(target_speed * 1.06, state.speed_x, target_speed);
 
@@ -115,10 +123,15 @@ CarSteers ExecutorRacing::Cycle(const CarState &state, double dt)
     return ret;
 }
 
+size_t ExecutorRacing::GetCurrentHinge() const { return current_hinge_; }
+
 void ExecutorRacing::Visualise(std::vector<Visualisation::Object> &objects) const
 {
-    Vector<2, false> cpv = current_hinge_->GetCrosspositionVector() * 3.0;
-    objects.push_back(Visualisation::Object(cpv + current_hinge_->GetPosition(),
-                                            cpv * -1.0 + current_hinge_->GetPosition(),
+    if (!racing_line_)
+        return;
+
+    auto position = racing_line_->GetPosition(current_hinge_);
+    Vector<2, false> cpv = racing_line_->GetCrosspositionVector(current_hinge_) * 3.0;
+    objects.push_back(Visualisation::Object(cpv + position, cpv * -1.0 + position,
                                             nullptr, SDL2pp::Color(255, 255, 255)));
 }
\ No newline at end of file
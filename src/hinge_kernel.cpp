@@ -0,0 +1,490 @@
+#include <cmath>
+#include <initializer_list>
+#include <type_traits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#include "hinge_kernel.h"
+
+namespace
+{
+double Sign(double x) { return (x > 0.0) - (x < 0.0); }
+float Sign(float x) { return float((x > 0.0f) - (x < 0.0f)); }
+
+// Value and its derivatives along N directions, for differentiating the gradient
+// expressions below once more in forward mode.
+template <int N> struct Dual
+{
+    double v;
+    double d[N];
+
+    Dual(double value = 0.0) : v(value), d{} {}
+};
+
+template <int N> Dual<N> operator+(const Dual<N> &a, const Dual<N> &b)
+{
+    Dual<N> r(a.v + b.v);
+    for (int i = 0; i < N; i++)
+        r.d[i] = a.d[i] + b.d[i];
+    return r;
+}
+
+template <int N> Dual<N> operator-(const Dual<N> &a, const Dual<N> &b)
+{
+    Dual<N> r(a.v - b.v);
+    for (int i = 0; i < N; i++)
+        r.d[i] = a.d[i] - b.d[i];
+    return r;
+}
+
+template <int N> Dual<N> operator*(const Dual<N> &a, const Dual<N> &b)
+{
+    Dual<N> r(a.v * b.v);
+    for (int i = 0; i < N; i++)
+        r.d[i] = a.d[i] * b.v + a.v * b.d[i];
+    return r;
+}
+
+template <int N> Dual<N> operator/(const Dual<N> &a, const Dual<N> &b)
+{
+    Dual<N> r(a.v / b.v);
+    for (int i = 0; i < N; i++)
+        r.d[i] = (a.d[i] - r.v * b.d[i]) / b.v;
+    return r;
+}
+
+template <int N> Dual<N> operator-(const Dual<N> &a) { return 0.0 - a; }
+template <int N> Dual<N> operator+(const Dual<N> &a, double b) { return a + Dual<N>(b); }
+template <int N> Dual<N> operator-(const Dual<N> &a, double b) { return a - Dual<N>(b); }
+template <int N> Dual<N> operator-(double a, const Dual<N> &b) { return Dual<N>(a) - b; }
+template <int N> Dual<N> operator*(const Dual<N> &a, double b) { return a * Dual<N>(b); }
+template <int N> Dual<N> operator*(double a, const Dual<N> &b) { return Dual<N>(a) * b; }
+template <int N> Dual<N> operator/(const Dual<N> &a, double b) { return a / Dual<N>(b); }
+template <int N> Dual<N> operator/(double a, const Dual<N> &b) { return Dual<N>(a) / b; }
+
+template <int N> Dual<N> sqrt(const Dual<N> &a)
+{
+    Dual<N> r(std::sqrt(a.v));
+    for (int i = 0; i < N; i++)
+        r.d[i] = a.d[i] / (2.0 * r.v);
+    return r;
+}
+
+template <int N> Dual<N> abs(const Dual<N> &a) { return Sign(a.v) * a; }
+
+// the sign is piecewise constant, so its derivative is taken as zero
+template <int N> double Sign(const Dual<N> &a) { return Sign(a.v); }
+
+using hinge_kernel::BasicResult;
+using hinge_kernel::BasicStencil;
+
+template <typename Real>
+BasicResult<Real> EvaluateTemplate(const BasicStencil<Real> &s,
+                                   double max_centrifugal_force, double max_acceleration)
+{
+    using std::abs;
+    using std::sqrt;
+
+    // float stencils keep their constants in float too, everything else uses double
+    using C = typename std::conditional<std::is_same<Real, float>::value, float,
+                                        double>::type;
+
+    // Same terms as HingeModel::Hinge::ComputeScoreThis. The circumcircle radius is
+    // expressed through the curvature k = 2|a| / (ln * lp * lq), where a is the signed
+    // doubled area of the (next, current, previous) triangle.
+    BasicResult<Real> ret;
+
+    const Real dn[2] = {s.next[0] - s.current[0], s.next[1] - s.current[1]};
+    const Real dp[2] = {s.current[0] - s.previous[0], s.current[1] - s.previous[1]};
+    const Real dq[2] = {s.next[0] - s.previous[0], s.next[1] - s.previous[1]};
+
+    const Real ln = sqrt(dn[0] * dn[0] + dn[1] * dn[1]);
+    const Real lp = sqrt(dp[0] * dp[0] + dp[1] * dp[1]);
+    const Real lq = sqrt(dq[0] * dq[0] + dq[1] * dq[1]);
+    const Real len = (ln + lp) / C(2.0);
+
+    // a = cross(current - next, previous - next)
+    const Real a = dn[0] * dq[1] - dn[1] * dq[0];
+    const Real lll = ln * lp * lq;
+    const Real k = C(2.0) * abs(a) / lll;
+
+    const Real speed = s.speed;
+    const Real centrifugal_force = speed * speed * k;
+    const Real speed_diff = speed - s.next_speed;
+    const Real acceleration = abs(speed_diff) / ln;
+
+    const Real f_margin = centrifugal_force - C(max_centrifugal_force);
+    const Real a_margin = acceleration - C(max_acceleration);
+
+    ret.score = -C(0.2) / f_margin - C(0.2) / a_margin + len / speed;
+    ret.centrifugal_force = centrifugal_force;
+
+    const Real w_f = C(0.2) / (f_margin * f_margin);
+    const Real w_a = C(0.2) / (a_margin * a_margin);
+    const Real w_k = w_f * speed * speed;
+
+    ret.d_speed =
+        w_f * C(2.0) * speed * k + w_a * Sign(speed_diff) / ln - len / (speed * speed);
+    ret.d_next_speed = -w_a * Sign(speed_diff) / ln;
+
+    // coefficients of the score w.r.t. the three side lengths and the area
+    const Real c_ln = -w_a * acceleration / ln + C(0.5) / speed - w_k * k / ln;
+    const Real c_lp = C(0.5) / speed - w_k * k / lp;
+    const Real c_lq = -w_k * k / lq;
+    const Real c_a = w_k * C(2.0) * Sign(a) / lll;
+
+    const Real da_current[2] = {s.previous[1] - s.next[1], s.next[0] - s.previous[0]};
+    const Real da_previous[2] = {s.next[1] - s.current[1], s.current[0] - s.next[0]};
+
+    for (int i = 0; i < 2; i++)
+    {
+        const Real n_part = c_ln * dn[i] / ln;
+        const Real p_part = c_lp * dp[i] / lp;
+        const Real q_part = c_lq * dq[i] / lq;
+
+        ret.d_current[i] = -n_part + p_part + c_a * da_current[i];
+        ret.d_previous[i] = -p_part - q_part + c_a * da_previous[i];
+        ret.d_next[i] = n_part + q_part - c_a * (da_current[i] + da_previous[i]);
+    }
+
+    return ret;
+}
+}
+
+hinge_kernel::Result hinge_kernel::Evaluate(const Stencil &s,
+                                            double max_centrifugal_force,
+                                            double max_acceleration)
+{
+    return EvaluateTemplate(s, max_centrifugal_force, max_acceleration);
+}
+
+void hinge_kernel::Hessian(const Stencil &s, const double directions[3][2],
+                           double max_centrifugal_force, double max_acceleration,
+                           double hessian[5][5])
+{
+    using D = Dual<5>;
+    BasicStencil<D> dual;
+
+    for (int c = 0; c < 2; c++)
+    {
+        dual.previous[c] = s.previous[c];
+        dual.previous[c].d[0] = directions[0][c];
+        dual.current[c] = s.current[c];
+        dual.current[c].d[1] = directions[1][c];
+        dual.next[c] = s.next[c];
+        dual.next[c].d[2] = directions[2][c];
+    }
+    dual.speed = s.speed;
+    dual.speed.d[3] = 1.0;
+    dual.next_speed = s.next_speed;
+    dual.next_speed.d[4] = 1.0;
+
+    auto r = EvaluateTemplate(dual, max_centrifugal_force, max_acceleration);
+
+    // first derivatives along the five parameters, each differentiated once more
+    const D gradient[5] = {
+        r.d_previous[0] * directions[0][0] + r.d_previous[1] * directions[0][1],
+        r.d_current[0] * directions[1][0] + r.d_current[1] * directions[1][1],
+        r.d_next[0] * directions[2][0] + r.d_next[1] * directions[2][1],
+        r.d_speed, r.d_next_speed};
+
+    for (int i = 0; i < 5; i++)
+    {
+        for (int j = 0; j < 5; j++)
+            hessian[i][j] = 0.5 * (gradient[i].d[j] + gradient[j].d[i]);
+    }
+}
+
+namespace
+{
+template <typename Real>
+void BatchScalar(const Real *x, const Real *y, const Real *speed, size_t begin,
+                 size_t end, double max_centrifugal_force, double max_acceleration,
+                 const hinge_kernel::BasicBatchOutput<Real> &out)
+{
+    for (size_t i = begin; i < end; i++)
+    {
+        BasicStencil<Real> stencil = {{x[i - 1], y[i - 1]},
+                                      {x[i], y[i]},
+                                      {x[i + 1], y[i + 1]},
+                                      speed[i],
+                                      speed[i + 1]};
+
+        auto result = EvaluateTemplate(stencil, max_centrifugal_force, max_acceleration);
+
+        const size_t k = i - begin;
+        out.score[k] = result.score;
+        out.centrifugal_force[k] = result.centrifugal_force;
+        for (int c = 0; c < 2; c++)
+        {
+            out.d_previous[c][k] = result.d_previous[c];
+            out.d_current[c][k] = result.d_current[c];
+            out.d_next[c][k] = result.d_next[c];
+        }
+        out.d_speed[k] = result.d_speed;
+        out.d_next_speed[k] = result.d_next_speed;
+    }
+}
+}
+
+void hinge_kernel::EvaluateBatchScalar(const double *x, const double *y,
+                                       const double *speed, size_t begin, size_t end,
+                                       double max_centrifugal_force,
+                                       double max_acceleration, const BatchOutput &out)
+{
+    BatchScalar(x, y, speed, begin, end, max_centrifugal_force, max_acceleration, out);
+}
+
+void hinge_kernel::EvaluateBatchScalar(const float *x, const float *y, const float *speed,
+                                       size_t begin, size_t end,
+                                       double max_centrifugal_force,
+                                       double max_acceleration,
+                                       const BasicBatchOutput<float> &out)
+{
+    BatchScalar(x, y, speed, begin, end, max_centrifugal_force, max_acceleration, out);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+namespace
+{
+// FMA is left out on purpose: without contraction every lane performs exactly the same
+// roundings as Evaluate(), so both implementations give bitwise identical results.
+#define AVX2_TARGET __attribute__((target("avx2")))
+
+// The arithmetic is overloaded for both precisions, so a single kernel body serves
+// four double or eight float lanes.
+AVX2_TARGET inline __m256d Add(__m256d a, __m256d b) { return _mm256_add_pd(a, b); }
+AVX2_TARGET inline __m256 Add(__m256 a, __m256 b) { return _mm256_add_ps(a, b); }
+AVX2_TARGET inline __m256d Sub(__m256d a, __m256d b) { return _mm256_sub_pd(a, b); }
+AVX2_TARGET inline __m256 Sub(__m256 a, __m256 b) { return _mm256_sub_ps(a, b); }
+AVX2_TARGET inline __m256d Mul(__m256d a, __m256d b) { return _mm256_mul_pd(a, b); }
+AVX2_TARGET inline __m256 Mul(__m256 a, __m256 b) { return _mm256_mul_ps(a, b); }
+AVX2_TARGET inline __m256d Div(__m256d a, __m256d b) { return _mm256_div_pd(a, b); }
+AVX2_TARGET inline __m256 Div(__m256 a, __m256 b) { return _mm256_div_ps(a, b); }
+AVX2_TARGET inline __m256d Sqrt(__m256d x) { return _mm256_sqrt_pd(x); }
+AVX2_TARGET inline __m256 Sqrt(__m256 x) { return _mm256_sqrt_ps(x); }
+
+AVX2_TARGET inline __m256d Abs(__m256d x)
+{
+    return _mm256_andnot_pd(_mm256_set1_pd(-0.0), x);
+}
+
+AVX2_TARGET inline __m256 Abs(__m256 x)
+{
+    return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), x);
+}
+
+AVX2_TARGET inline __m256d Sign(__m256d x)
+{
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d one = _mm256_set1_pd(1.0);
+
+    return _mm256_sub_pd(_mm256_and_pd(_mm256_cmp_pd(x, zero, _CMP_GT_OQ), one),
+                         _mm256_and_pd(_mm256_cmp_pd(x, zero, _CMP_LT_OQ), one));
+}
+
+AVX2_TARGET inline __m256 Sign(__m256 x)
+{
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+
+    return _mm256_sub_ps(_mm256_and_ps(_mm256_cmp_ps(x, zero, _CMP_GT_OQ), one),
+                         _mm256_and_ps(_mm256_cmp_ps(x, zero, _CMP_LT_OQ), one));
+}
+
+AVX2_TARGET inline __m256d Load(const double *p) { return _mm256_loadu_pd(p); }
+AVX2_TARGET inline __m256 Load(const float *p) { return _mm256_loadu_ps(p); }
+AVX2_TARGET inline void Store(double *p, __m256d x) { _mm256_storeu_pd(p, x); }
+AVX2_TARGET inline void Store(float *p, __m256 x) { _mm256_storeu_ps(p, x); }
+
+template <typename Real> struct Avx2Lanes;
+
+template <> struct Avx2Lanes<double>
+{
+    using Vector = __m256d;
+    static const size_t SIZE = 4;
+    AVX2_TARGET static Vector Set(double x) { return _mm256_set1_pd(x); }
+};
+
+template <> struct Avx2Lanes<float>
+{
+    using Vector = __m256;
+    static const size_t SIZE = 8;
+    AVX2_TARGET static Vector Set(float x) { return _mm256_set1_ps(x); }
+};
+
+template <typename Real>
+AVX2_TARGET void BatchAvx2(const Real *x, const Real *y, const Real *speed, size_t begin,
+                           size_t end, double max_centrifugal_force,
+                           double max_acceleration,
+                           const hinge_kernel::BasicBatchOutput<Real> &out)
+{
+    using Lanes = Avx2Lanes<Real>;
+    using V = typename Lanes::Vector;
+
+    const V zero = Lanes::Set(Real(0.0));
+    const V half = Lanes::Set(Real(0.5));
+    const V two = Lanes::Set(Real(2.0));
+    const V barrier = Lanes::Set(Real(0.2));
+    const V max_f = Lanes::Set(Real(max_centrifugal_force));
+    const V max_a = Lanes::Set(Real(max_acceleration));
+
+    size_t i = begin;
+    for (; i + Lanes::SIZE <= end; i += Lanes::SIZE)
+    {
+        // lane j holds the stencil centred at hinge i + j
+        const V px = Load(x + i - 1), py = Load(y + i - 1);
+        const V cx = Load(x + i), cy = Load(y + i);
+        const V nx = Load(x + i + 1), ny = Load(y + i + 1);
+        const V s = Load(speed + i);
+        const V s_next = Load(speed + i + 1);
+
+        const V dnx = Sub(nx, cx), dny = Sub(ny, cy);
+        const V dpx = Sub(cx, px), dpy = Sub(cy, py);
+        const V dqx = Sub(nx, px), dqy = Sub(ny, py);
+
+        const V ln = Sqrt(Add(Mul(dnx, dnx), Mul(dny, dny)));
+        const V lp = Sqrt(Add(Mul(dpx, dpx), Mul(dpy, dpy)));
+        const V lq = Sqrt(Add(Mul(dqx, dqx), Mul(dqy, dqy)));
+        const V len = Div(Add(ln, lp), two);
+
+        const V a = Sub(Mul(dnx, dqy), Mul(dny, dqx));
+        const V lll = Mul(Mul(ln, lp), lq);
+        const V k = Div(Mul(two, Abs(a)), lll);
+
+        const V centrifugal_force = Mul(Mul(s, s), k);
+        const V speed_diff = Sub(s, s_next);
+        const V acceleration = Div(Abs(speed_diff), ln);
+
+        const V f_margin = Sub(centrifugal_force, max_f);
+        const V a_margin = Sub(acceleration, max_a);
+
+        const V score = Add(
+            Sub(Div(Sub(zero, barrier), f_margin), Div(barrier, a_margin)), Div(len, s));
+
+        const V w_f = Div(barrier, Mul(f_margin, f_margin));
+        const V w_a = Div(barrier, Mul(a_margin, a_margin));
+        const V w_k = Mul(Mul(w_f, s), s);
+        const V a_term = Div(Mul(w_a, Sign(speed_diff)), ln);
+
+        const V d_speed =
+            Sub(Add(Mul(Mul(Mul(w_f, two), s), k), a_term), Div(len, Mul(s, s)));
+        const V d_next_speed = Div(Mul(Sub(zero, w_a), Sign(speed_diff)), ln);
+
+        const V half_s = Div(half, s);
+        const V c_ln = Sub(Add(Div(Mul(Sub(zero, w_a), acceleration), ln), half_s),
+                           Div(Mul(w_k, k), ln));
+        const V c_lp = Sub(half_s, Div(Mul(w_k, k), lp));
+        const V c_lq = Div(Mul(Sub(zero, w_k), k), lq);
+        const V c_a = Div(Mul(Mul(w_k, two), Sign(a)), lll);
+
+        const V da_current[2] = {Sub(py, ny), Sub(nx, px)};
+        const V da_previous[2] = {Sub(ny, cy), Sub(cx, nx)};
+        const V dn[2] = {dnx, dny}, dp[2] = {dpx, dpy}, dq[2] = {dqx, dqy};
+
+        const size_t o = i - begin;
+        for (int c = 0; c < 2; c++)
+        {
+            const V n_part = Div(Mul(c_ln, dn[c]), ln);
+            const V p_part = Div(Mul(c_lp, dp[c]), lp);
+            const V q_part = Div(Mul(c_lq, dq[c]), lq);
+
+            Store(out.d_current[c] + o,
+                  Add(Sub(p_part, n_part), Mul(c_a, da_current[c])));
+            Store(out.d_previous[c] + o,
+                  Add(Sub(Sub(zero, p_part), q_part), Mul(c_a, da_previous[c])));
+            Store(out.d_next[c] + o,
+                  Sub(Add(n_part, q_part), Mul(c_a, Add(da_current[c], da_previous[c]))));
+        }
+
+        Store(out.score + o, score);
+        Store(out.centrifugal_force + o, centrifugal_force);
+        Store(out.d_speed + o, d_speed);
+        Store(out.d_next_speed + o, d_next_speed);
+    }
+
+    if (i == end)
+        return;
+
+    // remainder shorter than a vector
+    hinge_kernel::BasicBatchOutput<Real> rest = out;
+    const size_t o = i - begin;
+    for (Real **p :
+         {&rest.score, &rest.centrifugal_force, &rest.d_previous[0], &rest.d_previous[1],
+          &rest.d_current[0], &rest.d_current[1], &rest.d_next[0], &rest.d_next[1],
+          &rest.d_speed, &rest.d_next_speed})
+        *p += o;
+
+    BatchScalar(x, y, speed, i, end, max_centrifugal_force, max_acceleration, rest);
+}
+}
+
+void hinge_kernel::EvaluateBatchAvx2(const double *x, const double *y,
+                                     const double *speed, size_t begin, size_t end,
+                                     double max_centrifugal_force,
+                                     double max_acceleration, const BatchOutput &out)
+{
+    BatchAvx2(x, y, speed, begin, end, max_centrifugal_force, max_acceleration, out);
+}
+
+void hinge_kernel::EvaluateBatchAvx2(const float *x, const float *y, const float *speed,
+                                     size_t begin, size_t end,
+                                     double max_centrifugal_force,
+                                     double max_acceleration,
+                                     const BasicBatchOutput<float> &out)
+{
+    BatchAvx2(x, y, speed, begin, end, max_centrifugal_force, max_acceleration, out);
+}
+
+bool hinge_kernel::Avx2Supported() { return __builtin_cpu_supports("avx2"); }
+
+#undef AVX2_TARGET
+
+#else
+
+void hinge_kernel::EvaluateBatchAvx2(const double *x, const double *y,
+                                     const double *speed, size_t begin, size_t end,
+                                     double max_centrifugal_force,
+                                     double max_acceleration, const BatchOutput &out)
+{
+    BatchScalar(x, y, speed, begin, end, max_centrifugal_force, max_acceleration, out);
+}
+
+void hinge_kernel::EvaluateBatchAvx2(const float *x, const float *y, const float *speed,
+                                     size_t begin, size_t end,
+                                     double max_centrifugal_force,
+                                     double max_acceleration,
+                                     const BasicBatchOutput<float> &out)
+{
+    BatchScalar(x, y, speed, begin, end, max_centrifugal_force, max_acceleration, out);
+}
+
+bool hinge_kernel::Avx2Supported() { return false; }
+
+#endif
+
+void hinge_kernel::EvaluateBatch(const double *x, const double *y, const double *speed,
+                                 size_t begin, size_t end, double max_centrifugal_force,
+                                 double max_acceleration, const BatchOutput &out)
+{
+    using Batch = void (*)(const double *, const double *, const double *, size_t, size_t,
+                           double, double, const BatchOutput &);
+    static const Batch batch = Avx2Supported() ? Batch(EvaluateBatchAvx2)
+                                               : Batch(EvaluateBatchScalar);
+    batch(x, y, speed, begin, end, max_centrifugal_force, max_acceleration, out);
+}
+
+void hinge_kernel::EvaluateBatch(const float *x, const float *y, const float *speed,
+                                 size_t begin, size_t end, double max_centrifugal_force,
+                                 double max_acceleration,
+                                 const BasicBatchOutput<float> &out)
+{
+    using Batch = void (*)(const float *, const float *, const float *, size_t, size_t,
+                           double, double, const BasicBatchOutput<float> &);
+    static const Batch batch = Avx2Supported() ? Batch(EvaluateBatchAvx2)
+                                               : Batch(EvaluateBatchScalar);
+    batch(x, y, speed, begin, end, max_centrifugal_force, max_acceleration, out);
+}
@@ -1,284 +1,1329 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+
 #include "hinge_model.h"
 #include "config.h"
 #include "exceptions.h"
+#include "hinge_kernel.h"
 #include "util.h"
 
 using std::get;
 
-HingeModel::HingeModel(uint32_t width, uint32_t height, float collision_zone_side)
-    : width_(width), height_(height), collision_zone_side_(collision_zone_side),
-      alpha_(Config::inst().GetOption<float>("alpha")), first_hinge_(nullptr),
-      max_centrifugal_force_(Config::inst().GetOption<float>("max_centrifugal_force")),
-      max_acceleration_(Config::inst().GetOption<float>("max_acceleration"))
+// parallel evaluation kicks in only if every chunk gets at least that many hinges
+const size_t MIN_CHUNK_HINGES = 64;
+
+// number of stencils handed to the analytic kernel at once
+const size_t KERNEL_BLOCK = 256;
+
+namespace
+{
+// Runs the kernel on the stencils centred at [begin, end) in the precision of Real,
+// widening its results to double.
+template <typename Real>
+void EvaluateBlock(const double *x, const double *y, const double *speed, size_t begin,
+                   size_t end, double max_centrifugal_force, double max_acceleration,
+                   const hinge_kernel::BatchOutput &out)
 {
-    for (uint32_t x = 0; x < width; ++x)
+    if constexpr (std::is_same<Real, double>::value)
+    {
+        hinge_kernel::EvaluateBatch(x, y, speed, begin, end, max_centrifugal_force,
+                                    max_acceleration, out);
+    }
+    else
     {
-        collision_zones_.emplace_back();
-        for (uint32_t y = 0; y < height; ++y)
+        // Positions are taken relative to the first centre while still in double, so
+        // the narrow copies only hold the short distances between the hinges.
+        Real narrow_x[KERNEL_BLOCK + 2], narrow_y[KERNEL_BLOCK + 2];
+        Real narrow_speed[KERNEL_BLOCK + 2];
+        for (size_t i = begin - 1; i <= end; i++)
         {
-            auto collision_zone = new HingeCollisionZone(
-                this,
-                Vector<2, false>({{x * collision_zone_side, y * collision_zone_side}}),
-                collision_zone_side);
-            (collision_zones_.end() - 1)->push_back(collision_zone);
-            AddChild(collision_zone);
+            narrow_x[i - begin + 1] = Real(x[i] - x[begin]);
+            narrow_y[i - begin + 1] = Real(y[i] - y[begin]);
+            narrow_speed[i - begin + 1] = Real(speed[i]);
         }
+
+        Real block[10][KERNEL_BLOCK];
+        const hinge_kernel::BasicBatchOutput<Real> narrow_out = {
+            block[0], block[1], {block[2], block[3]}, {block[4], block[5]},
+            {block[6], block[7]}, block[8], block[9]};
+
+        hinge_kernel::EvaluateBatch(narrow_x, narrow_y, narrow_speed, 1, end - begin + 1,
+                                    max_centrifugal_force, max_acceleration, narrow_out);
+
+        double *const wide[10] = {out.score,         out.centrifugal_force,
+                                  out.d_previous[0], out.d_previous[1],
+                                  out.d_current[0],  out.d_current[1],
+                                  out.d_next[0],     out.d_next[1],
+                                  out.d_speed,       out.d_next_speed};
+        for (size_t a = 0; a < 10; a++)
+            std::copy(block[a], block[a] + (end - begin), wide[a]);
     }
 }
+}
+
+HingeModel::Hyperparameters HingeModel::Hyperparameters::FromConfig()
+{
+    Hyperparameters ret;
+    ret.alpha = Config::inst().GetOption<float>("alpha");
+    ret.max_centrifugal_force = Config::inst().GetOption<float>("max_centrifugal_force");
+    ret.optimizer_threads = Config::inst().GetOption<int>("optimizer_threads");
+    return ret;
+}
 
-std::pair<int, int> HingeModel::CoordinatesToCollisionZone(Vector<2, false> pos)
+HingeModel::HingeModel() : HingeModel(Hyperparameters::FromConfig()) {}
+
+HingeModel::HingeModel(const Hyperparameters &hyperparameters)
+    : boundary_collisions_(Config::inst().GetOption<bool>("boundary_collisions")),
+      collision_grid_built_(false),
+      edge_crossing_valid_(false),
+      boundary_penalty_(Config::inst().GetOption<float>("boundary_penalty")),
+      boundary_margin_(Config::inst().GetOption<float>("boundary_margin")),
+      distance_field_(Config::inst().GetOption<float>("distance_field_spacing"),
+                      Config::inst().GetOption<float>("distance_field_range")),
+      distance_field_built_(false),
+      max_centrifugal_force_(hyperparameters.max_centrifugal_force),
+      max_acceleration_(Config::inst().GetOption<float>("max_acceleration")),
+      speed_step_scale_(Config::inst().GetOption<float>("speed_step_scale")),
+      precision_polish_(Config::inst().GetOption<bool>("precision_polish")),
+      polishing_(false),
+      last_score_(0.0), last_feasible_(true), evaluated_(false),
+      alpha_(hyperparameters.alpha),
+      newton_(Config::inst().GetOption<std::string>("optimizer") == "newton"),
+      newton_initial_damping_(Config::inst().GetOption<float>("newton_damping")),
+      newton_damping_(newton_initial_damping_),
+      line_search_c1_(Config::inst().GetOption<float>("line_search_c1")),
+      line_search_backtracks_(Config::inst().GetOption<int>("line_search_backtracks")),
+      line_search_max_scale_(Config::inst().GetOption<float>("line_search_max_scale")),
+      step_scale_(1.0),
+      convergence_gradient_norm_(
+          Config::inst().GetOption<float>("convergence_gradient_norm")),
+      convergence_relative_improvement_(
+          Config::inst().GetOption<float>("convergence_relative_improvement")),
+      convergence_steps_(Config::inst().GetOption<int>("convergence_steps")),
+      stalled_steps_(0), converged_(false),
+      incremental_tolerance_(Config::inst().GetOption<float>("incremental_tolerance")),
+      incremental_refresh_(Config::inst().GetOption<int>("incremental_refresh")),
+      window_first_(0), window_end_(SIZE_MAX)
 {
-    std::pair<int, int> ret;
+    auto gradient_backend = Config::inst().GetOption<std::string>("gradient_backend");
+    if (gradient_backend == "adept")
+        gradient_backend_ = GradientBackend::Adept;
+    else if (gradient_backend == "analytic")
+        gradient_backend_ = GradientBackend::Analytic;
+    else
+        throw Exception("Unknown gradient backend: " + gradient_backend);
 
-    // ASSERT(pos(0, 0) < collision_zone_side_ * float(width_));
-    // ASSERT(pos(0, 1) < collision_zone_side_ * float(height_));
+    auto precision = Config::inst().GetOption<std::string>("precision");
+    if (precision == "double")
+        precision_ = Precision::Double;
+    else if (precision == "float")
+        precision_ = Precision::Float;
+    else
+        throw Exception("Unknown precision: " + precision);
 
-    ret.first = pos(0, 0) / collision_zone_side_;
-    ret.second = pos(0, 1) / collision_zone_side_;
+    if (gradient_backend_ == GradientBackend::Analytic)
+    {
+        log_.Info() << "Analytic gradient kernel: "
+                    << (hinge_kernel::Avx2Supported() ? "AVX2" : "scalar") << ", "
+                    << precision;
+    }
 
-    return ret;
+    if (precision_ == Precision::Float && gradient_backend_ != GradientBackend::Analytic)
+        throw Exception("Float precision needs the analytic gradient backend");
+
+    if (incremental_tolerance_ > 0.0 && gradient_backend_ != GradientBackend::Analytic)
+        throw Exception("Incremental evaluation needs the analytic gradient backend");
+
+    if (hyperparameters.optimizer_threads > 1)
+    {
+        workers_ = std::make_unique<WorkerPool>(hyperparameters.optimizer_threads);
+        chunks_.resize(hyperparameters.optimizer_threads);
+    }
+}
+
+size_t HingeModel::AddHinge(Vector<2, false> position, double width, double forward)
+{
+    const size_t index = GetHingeCount();
+
+    hinges_.zero_x.push_back(position(0, 0));
+    hinges_.zero_y.push_back(position(0, 1));
+    hinges_.crossposition_vector_x.push_back(0.0);
+    hinges_.crossposition_vector_y.push_back(0.0);
+    hinges_.crossposition.push_back(0.0);
+    hinges_.speed.push_back(10.0);
+    hinges_.width.push_back(width);
+    hinges_.forward.push_back(forward);
+    hinges_.position_x.push_back(position(0, 0));
+    hinges_.position_y.push_back(position(0, 1));
+    hinges_.crossposition_gradient.push_back(0.0);
+    hinges_.speed_gradient.push_back(0.0);
+    last_centrifugal_force_.push_back(0.0);
+    hinge_views_.emplace_back(this, index);
+    StateChanged();
+
+    // the crossposition vector of a hinge is perpendicular to the heading towards the
+    // next one, so it's known as soon as the next hinge is added
+    if (index > 0)
+    {
+        const size_t p = index - 1;
+        double hx = hinges_.zero_x[index] - hinges_.zero_x[p];
+        double hy = hinges_.zero_y[index] - hinges_.zero_y[p];
+        double heading_norm = std::sqrt(hx * hx + hy * hy);
+
+        hinges_.crossposition_vector_x[p] = -hy / heading_norm * hinges_.width[p];
+        hinges_.crossposition_vector_y[p] = hx / heading_norm * hinges_.width[p];
+    }
+
+    return index;
+}
+
+HingeModel::BandSegement *HingeModel::AddBandSegment(Vector<2, false> position,
+                                                     BandSegement::Side side)
+{
+    auto band_segment = band_segments_.Create(this, position, side);
+    elements_.Add(band_segment);
+    return band_segment;
+}
+
+void HingeModel::SetupEquations()
+{
+    SetupEquationsThis();
+    elements_.SetupEquations();
+}
+
+void HingeModel::ComputeScore(adept::aReal &score)
+{
+    ComputeScoreThis(score);
+    elements_.ComputeScore(score);
+}
+
+void HingeModel::Visualise(std::vector<Visualisation::Object> &objects)
+{
+    VisualiseThis(objects);
+    elements_.Visualise(objects);
+}
+
+void HingeModel::SetupEquationsThis()
+{
+    const size_t n = GetHingeCount();
+    for (size_t i = 0; i < n; i++)
+    {
+        hinges_.position_x[i] =
+            hinges_.zero_x[i] +
+            hinges_.crossposition_vector_x[i] * hinges_.crossposition[i];
+        hinges_.position_y[i] =
+            hinges_.zero_y[i] +
+            hinges_.crossposition_vector_y[i] * hinges_.crossposition[i];
+    }
 }
 
-void HingeModel::AddHinge(Hinge *h)
+void HingeModel::ComputeScoreThis(adept::aReal &score) const
 {
-    if (!first_hinge_)
-        first_hinge_ = h;
+    std::vector<adept::aReal> crossposition(hinges_.crossposition.begin(),
+                                            hinges_.crossposition.end());
+    std::vector<adept::aReal> speed(hinges_.speed.begin(), hinges_.speed.end());
 
-    AddChild(h);
+    score += HingeScore(0, crossposition, speed);
+
+    double gradient, curvature;
+    for (size_t i = 1; i + 1 < GetHingeCount(); i++)
+        score += HingePenalty(i, gradient, curvature);
+}
+
+void HingeModel::VisualiseThis(std::vector<Visualisation::Object> &objects) const
+{
+    for (size_t i = 0; i + 1 < GetHingeCount(); i++)
+    {
+        objects.push_back(Visualisation::Object(
+            hinge_views_[i].GetPosition(), hinge_views_[i + 1].GetPosition(),
+            &hinge_views_[i], SpeedToColor(hinges_.speed[i])));
+    }
 }
 
-void HingeModel::AddBandSegment(BandSegement *bs) { AddChild(bs); }
+void HingeModel::ResetOptimizer()
+{
+    const size_t n = GetHingeCount();
 
-void HingeModel::SetupEquationsThis() {}
+    if (newton_)
+        newton_damping_ = newton_initial_damping_;
+    else
+        optimizer_ = Optimizer::Create(2 * n, alpha_);
 
-void HingeModel::ComputeScoreThis(adept::aReal &score) const {}
+    parameters_.resize(2 * n);
+    parameter_gradient_.resize(2 * n);
+    step_scale_ = 1.0;
+}
 
-void HingeModel::VisualiseThis(std::vector<Visualisation::Object> &objects) const {}
+bool HingeModel::StartPolishing()
+{
+    if (GetPrecision() != Precision::Float || !precision_polish_)
+        return false;
+
+    log_.Info() << "Polishing the single precision result in double precision";
+    polishing_ = true;
+    // the cached stencils were evaluated in float, so start with a full evaluation
+    stencil_cache_.score.clear();
+    evaluated_ = false;
+    stalled_steps_ = 0;
+    return true;
+}
 
-void HingeModel::ApplyGradientThis(double score_normalization) {}
+void HingeModel::StateChanged()
+{
+    // The gradients may have been recomputed by a full pass which the cached stencils
+    // know nothing about, so the next incremental evaluation starts over.
+    stencil_cache_.score.clear();
+    evaluated_ = false;
+    polishing_ = false;
+    edge_crossing_valid_ = false;
+    held_.clear();
+    converged_ = false;
+    stalled_steps_ = 0;
+}
 
-double HingeModel::Optimize(adept::Stack &stack)
+void HingeModel::ApplyGradientThis(double score_normalization)
 {
-    double score_normalization = 1.0;
-    if (first_last_score_)
-        score_normalization = first_last_score_->first / first_last_score_->second;
+    const size_t n = GetHingeCount();
+    if (newton_)
+    {
+        // scale invariant, the normalization doesn't matter
+        NewtonStep();
+        evaluated_ = false;
+        return;
+    }
+
+    if (!optimizer_ || optimizer_->GetSize() != 2 * n)
+        ResetOptimizer();
+
+    // Speeds are handed over divided by sqrt(speed_step_scale), which makes a plain
+    // gradient step move them speed_step_scale times faster than crosspositions.
+    const double speed_unit = std::sqrt(speed_step_scale_);
+
+    for (size_t i = 0; i < n; i++)
+    {
+        parameters_[i] = hinges_.crossposition[i];
+        parameter_gradient_[i] = hinges_.crossposition_gradient[i] * score_normalization;
+        parameters_[n + i] = hinges_.speed[i] / speed_unit;
+        parameter_gradient_[n + i] =
+            hinges_.speed_gradient[i] * speed_unit * score_normalization;
+    }
+
+    // the first and the last hinge are pinned to the track centre
+    parameter_gradient_[0] = 0.0;
+    parameter_gradient_[n - 1] = 0.0;
+
+    for (size_t i = 0; HasWindow() && i < n; i++)
+    {
+        if (!InWindow(i))
+            parameter_gradient_[i] = parameter_gradient_[n + i] = 0.0;
+    }
+
+    // Past a barrier the score flips sign, so it mustn't be mistaken for an improvement.
+    const double score = last_feasible_ ? last_score_ * score_normalization
+                                        : std::numeric_limits<double>::infinity();
+    optimizer_->Step(score, parameter_gradient_, parameters_);
+
+    for (size_t i = 0; i < n; i++)
+        hinges_.speed[i] = parameters_[n + i] * speed_unit;
+
+    for (size_t i = 1; i + 1 < n; i++)
+    {
+        double &cp = hinges_.crossposition[i];
+        cp = parameters_[i];
+
+        if (std::abs(cp) > 1.0)
+            cp /= std::abs(cp);
+    }
+
+    evaluated_ = false;
+}
 
+adept::aReal HingeModel::HingeScore(size_t first,
+                                    const std::vector<adept::aReal> &crossposition,
+                                    const std::vector<adept::aReal> &speed) const
+{
+    const size_t n = crossposition.size();
     adept::aReal score = 0.0;
-    stack.new_recording();
 
-    SetupEquations();
-    ComputeScore(score);
+    std::vector<Vector<2, true>> position(n);
+    for (size_t i = 0; i < n; i++)
+    {
+        const size_t h = first + i;
+        position[i] = Vector<2, false>({{hinges_.zero_x[h], hinges_.zero_y[h]}}) +
+                      Vector<2, false>({{hinges_.crossposition_vector_x[h],
+                                         hinges_.crossposition_vector_y[h]}}) *
+                          crossposition[i];
+    }
+
+    for (size_t i = 1; i + 1 < n; i++)
+    {
+        Vector<2, true> position_diff_n = position[i + 1] - position[i];
+        Vector<2, true> position_diff_p = position[i] - position[i - 1];
+
+        adept::aReal len =
+            (adept::norm2(position_diff_n) + adept::norm2(position_diff_p)) / 2.0;
+
+        adept::aReal r =
+            util::CircumcircleRadius(position[i + 1], position[i], position[i - 1]);
+
+        adept::aReal centrifugal_force = (speed[i] * speed[i]) / r;
+
+        score += -0.2 / (centrifugal_force - max_centrifugal_force_);
+        score += -0.2 / (adept::abs(speed[i] - speed[i + 1]) /
+                             adept::norm2(position_diff_n) -
+                         max_acceleration_);
+
+        last_centrifugal_force_[first + i] = centrifugal_force.value();
+
+        score += len / speed[i];
+    }
+
+    return score;
+}
+
+double HingeModel::AdeptGradient(adept::Stack &stack, size_t first, size_t last,
+                                 double *crossposition_gradient,
+                                 double *speed_gradient) const
+{
+    // independent variables have to be set before the recording starts
+    std::vector<adept::aReal> crossposition(hinges_.crossposition.begin() + first,
+                                            hinges_.crossposition.begin() + last);
+    std::vector<adept::aReal> speed(hinges_.speed.begin() + first,
+                                    hinges_.speed.begin() + last);
+
+    stack.new_recording();
+    adept::aReal score = HingeScore(first, crossposition, speed);
 
     score.set_gradient(1.0); // could use this for score_normalization
     stack.reverse();
-    // ApplyGradient(score_normalization);
-    ApplyGradient(1.0);
-
-    log_.Info() << "Optimization step done, score = " << score.value()
-                << ", normalization = " << score_normalization;
 
-    if (first_last_score_)
-        first_last_score_ =
-            std::pair<double, double>(first_last_score_->first, (double)score.value());
-    else
-        first_last_score_ = std::pair<double, double>(score.value(), score.value());
+    for (size_t i = 0; i < last - first; i++)
+    {
+        crossposition_gradient[i] = crossposition[i].get_gradient();
+        speed_gradient[i] = speed[i].get_gradient();
+    }
 
     return score.value();
 }
 
-HingeModel::Hinge *HingeModel::GetFirstHinge() const { return first_hinge_; }
+double HingeModel::AnalyticGradient(size_t first, size_t last,
+                                    double *crossposition_gradient,
+                                    double *speed_gradient) const
+{
+    double score = 0.0;
+
+    std::fill(crossposition_gradient, crossposition_gradient + (last - first), 0.0);
+    std::fill(speed_gradient, speed_gradient + (last - first), 0.0);
+
+    // stencils are evaluated in blocks small enough for the kernel output to stay in L1
+    double block[10][KERNEL_BLOCK];
+    const hinge_kernel::BatchOutput out = {block[0], block[1], {block[2], block[3]},
+                                           {block[4], block[5]}, {block[6], block[7]},
+                                           block[8], block[9]};
+
+    for (size_t begin = first + 1; begin + 1 < last; begin += KERNEL_BLOCK)
+    {
+        const size_t end = std::min(begin + KERNEL_BLOCK, last - 1);
 
-// ================ COLLISION_ZONE ================
+        EvaluateStencils(begin, end, out);
 
-HingeModel::HingeCollisionZone::HingeCollisionZone(HingeModel *model,
-                                                   Vector<2, false> position, float side)
-    : position_(position), collision_zone_side_(side)
+        for (size_t i = begin; i < end; i++)
+        {
+            const size_t k = i - begin;
+            const size_t local = i - first;
+
+            score += out.score[k];
+            last_centrifugal_force_[i] = out.centrifugal_force[k];
+
+            crossposition_gradient[local - 1] +=
+                out.d_previous[0][k] * hinges_.crossposition_vector_x[i - 1] +
+                out.d_previous[1][k] * hinges_.crossposition_vector_y[i - 1];
+            crossposition_gradient[local] +=
+                out.d_current[0][k] * hinges_.crossposition_vector_x[i] +
+                out.d_current[1][k] * hinges_.crossposition_vector_y[i];
+            crossposition_gradient[local + 1] +=
+                out.d_next[0][k] * hinges_.crossposition_vector_x[i + 1] +
+                out.d_next[1][k] * hinges_.crossposition_vector_y[i + 1];
+
+            speed_gradient[local] += out.d_speed[k];
+            speed_gradient[local + 1] += out.d_next_speed[k];
+        }
+    }
+
+    return score;
+}
+
+void HingeModel::EvaluateStencils(size_t begin, size_t end,
+                                  const hinge_kernel::BatchOutput &out) const
 {
+    auto evaluate = GetPrecision() == Precision::Float ? EvaluateBlock<float>
+                                                       : EvaluateBlock<double>;
+    evaluate(hinges_.position_x.data(), hinges_.position_y.data(), hinges_.speed.data(),
+             begin, end, max_centrifugal_force_, max_acceleration_, out);
 }
 
-void HingeModel::HingeCollisionZone::ComputeScoreThis(adept::aReal &score) const {}
+double HingeModel::ChunkedGradient()
+{
+    const size_t chunks_n = chunks_.size();
+    const size_t centres_n = GetHingeCount() - 2;
+
+    workers_->Run(chunks_n, [this, chunks_n, centres_n](size_t c) {
+        // stencils centred in [begin, end) belong to this chunk, the hinges right
+        // before and after them are the halo shared with the neighbouring chunks
+        const size_t begin = 1 + centres_n * c / chunks_n;
+        const size_t end = 1 + centres_n * (c + 1) / chunks_n;
+
+        auto &chunk = chunks_[c];
+        chunk.first = begin - 1;
+        chunk.crossposition_gradient.resize(end - begin + 2);
+        chunk.speed_gradient.resize(end - begin + 2);
+
+        if (gradient_backend_ == GradientBackend::Analytic)
+        {
+            chunk.score =
+                AnalyticGradient(begin - 1, end + 1, chunk.crossposition_gradient.data(),
+                                 chunk.speed_gradient.data());
+        }
+        else
+        {
+            static thread_local adept::Stack worker_stack;
+            chunk.score = AdeptGradient(worker_stack, begin - 1, end + 1,
+                                        chunk.crossposition_gradient.data(),
+                                        chunk.speed_gradient.data());
+        }
+    });
+
+    double score = 0.0;
+    std::fill(hinges_.crossposition_gradient.begin(),
+              hinges_.crossposition_gradient.end(), 0.0);
+    std::fill(hinges_.speed_gradient.begin(), hinges_.speed_gradient.end(), 0.0);
+
+    for (const auto &chunk : chunks_)
+    {
+        score += chunk.score;
+        for (size_t i = 0; i < chunk.speed_gradient.size(); i++)
+        {
+            hinges_.crossposition_gradient[chunk.first + i] +=
+                chunk.crossposition_gradient[i];
+            hinges_.speed_gradient[chunk.first + i] += chunk.speed_gradient[i];
+        }
+    }
+
+    return score;
+}
 
-void HingeModel::HingeCollisionZone::VisualiseThis(
-    std::vector<Visualisation::Object> &objects) const
+double HingeModel::IncrementalGradient()
 {
-    // objects.push_back(Visualisation::Object(
-    //    {position_, position_ + Vector<2, false>({collision_zone_side_, 0.0f})},
-    //    SDL2pp::Color(32, 32, 32)));
-    // objects.push_back(Visualisation::Object(
-    //    {position_, position_ + Vector<2, false>({0.0f, collision_zone_side_})},
-    //    SDL2pp::Color(32, 32, 32)));
-    // objects.push_back(Visualisation::Object(
-    //    {position_ + Vector<2, false>(collision_zone_side_, collision_zone_side_),
-    //     position_ + Vector<2, false>(collision_zone_side_, 0)},
-    //    SDL2pp::Color(32, 32, 32)));
-    // objects.push_back(Visualisation::Object(
-    //    {position_ + Vector<2, false>(collision_zone_side_, collision_zone_side_),
-    //     position_ + Vector<2, false>(0, collision_zone_side_)},
-    //    SDL2pp::Color(32, 32, 32)));
+    const size_t n = GetHingeCount();
+    auto &cache = stencil_cache_;
+
+    if (cache.score.size() != n || ++cache.updates >= incremental_refresh_)
+    {
+        cache.score.assign(n, 0.0);
+        for (auto &gradient : cache.crossposition_gradient)
+            gradient.assign(n, 0.0);
+        for (auto &gradient : cache.speed_gradient)
+            gradient.assign(n, 0.0);
+        cache.feasible.assign(n, 1);
+        cache.crossposition = hinges_.crossposition;
+        cache.speed = hinges_.speed;
+        cache.dirty.assign(n, StencilCache::CLEAN);
+        cache.total = 0.0;
+        cache.infeasible_n = 0;
+        cache.updates = 0;
+
+        std::fill(hinges_.crossposition_gradient.begin(),
+                  hinges_.crossposition_gradient.end(), 0.0);
+        std::fill(hinges_.speed_gradient.begin(), hinges_.speed_gradient.end(), 0.0);
+
+        SetupEquationsThis();
+        UpdateStencils(1, n - 1);
+        return cache.total;
+    }
+
+    // Speeds are compared relatively, crosspositions are already relative to the track
+    // width. A moved hinge changes the stencils centred at it and at both neighbours.
+    for (size_t i = 0; i < n; i++)
+    {
+        const double crossposition_change =
+            std::abs(hinges_.crossposition[i] - cache.crossposition[i]);
+        const double speed_change = std::abs(hinges_.speed[i] - cache.speed[i]);
+        if (crossposition_change == 0.0 && speed_change == 0.0)
+            continue;
+
+        hinges_.position_x[i] =
+            hinges_.zero_x[i] +
+            hinges_.crossposition_vector_x[i] * hinges_.crossposition[i];
+        hinges_.position_y[i] =
+            hinges_.zero_y[i] +
+            hinges_.crossposition_vector_y[i] * hinges_.crossposition[i];
+
+        // A line could creep past the barriers in steps below the tolerance, so the
+        // feasibility of the stencils is checked however little the hinge moved.
+        uint8_t state = StencilCache::DRIFTED;
+        if (crossposition_change > incremental_tolerance_ ||
+            speed_change > incremental_tolerance_ * std::abs(cache.speed[i]))
+        {
+            cache.crossposition[i] = hinges_.crossposition[i];
+            cache.speed[i] = hinges_.speed[i];
+            state = StencilCache::DIRTY;
+        }
+
+        for (size_t c = std::max<size_t>(i, 2) - 1; c <= i + 1 && c + 1 < n; c++)
+            cache.dirty[c] = std::max(cache.dirty[c], state);
+    }
+
+    for (size_t begin = 1; begin + 1 < n;)
+    {
+        const uint8_t state = cache.dirty[begin];
+        if (state == StencilCache::CLEAN)
+        {
+            begin++;
+            continue;
+        }
+
+        size_t end = begin;
+        while (end + 1 < n && cache.dirty[end] == state)
+            cache.dirty[end++] = StencilCache::CLEAN;
+
+        if (state == StencilCache::DIRTY)
+            UpdateStencils(begin, end);
+        else
+            CheckStencils(begin, end);
+        begin = end;
+    }
+
+    return cache.total;
 }
 
-void HingeModel::HingeCollisionZone::SetupEquationsThis() {}
+void HingeModel::UpdateStencils(size_t begin, size_t end)
+{
+    auto &cache = stencil_cache_;
+
+    double block[10][KERNEL_BLOCK];
+    const hinge_kernel::BatchOutput out = {block[0], block[1], {block[2], block[3]},
+                                           {block[4], block[5]}, {block[6], block[7]},
+                                           block[8], block[9]};
+
+    for (size_t block_begin = begin; block_begin < end; block_begin += KERNEL_BLOCK)
+    {
+        const size_t block_end = std::min(block_begin + KERNEL_BLOCK, end);
+
+        EvaluateStencils(block_begin, block_end, out);
+
+        for (size_t i = block_begin; i < block_end; i++)
+        {
+            const size_t k = i - block_begin;
+
+            const double crossposition_gradient[3] = {
+                out.d_previous[0][k] * hinges_.crossposition_vector_x[i - 1] +
+                    out.d_previous[1][k] * hinges_.crossposition_vector_y[i - 1],
+                out.d_current[0][k] * hinges_.crossposition_vector_x[i] +
+                    out.d_current[1][k] * hinges_.crossposition_vector_y[i],
+                out.d_next[0][k] * hinges_.crossposition_vector_x[i + 1] +
+                    out.d_next[1][k] * hinges_.crossposition_vector_y[i + 1]};
+            const double speed_gradient[2] = {out.d_speed[k], out.d_next_speed[k]};
+
+            // replace the stencil's previous contributions with the new ones
+            for (int h = 0; h < 3; h++)
+            {
+                hinges_.crossposition_gradient[i + h - 1] +=
+                    crossposition_gradient[h] - cache.crossposition_gradient[h][i];
+                cache.crossposition_gradient[h][i] = crossposition_gradient[h];
+            }
+
+            for (int h = 0; h < 2; h++)
+            {
+                hinges_.speed_gradient[i + h] +=
+                    speed_gradient[h] - cache.speed_gradient[h][i];
+                cache.speed_gradient[h][i] = speed_gradient[h];
+            }
 
-void HingeModel::HingeCollisionZone::ApplyGradientThis(double score_normalization) {}
+            cache.total += out.score[k] - cache.score[i];
+            cache.score[i] = out.score[k];
+            UpdateFeasible(i, out.centrifugal_force[k]);
+        }
+    }
+}
 
-bool HingeModel::HingeCollisionZone::Collides(Segment *seg) const
+void HingeModel::CheckStencils(size_t begin, size_t end)
 {
-    for (const auto &s : segments_)
+    double block[10][KERNEL_BLOCK];
+    const hinge_kernel::BatchOutput out = {block[0], block[1], {block[2], block[3]},
+                                           {block[4], block[5]}, {block[6], block[7]},
+                                           block[8], block[9]};
+
+    for (size_t block_begin = begin; block_begin < end; block_begin += KERNEL_BLOCK)
     {
-        if (HingeModel::Segment::Intersects(s, seg))
-            return true;
+        const size_t block_end = std::min(block_begin + KERNEL_BLOCK, end);
+
+        EvaluateStencils(block_begin, block_end, out);
+
+        for (size_t i = block_begin; i < block_end; i++)
+            UpdateFeasible(i, out.centrifugal_force[i - block_begin]);
     }
+}
 
-    return false;
+void HingeModel::UpdateFeasible(size_t i, double centrifugal_force)
+{
+    auto &cache = stencil_cache_;
+
+    last_centrifugal_force_[i] = centrifugal_force;
+
+    const bool feasible = centrifugal_force < max_centrifugal_force_ &&
+                          StencilAcceleration(i) < max_acceleration_;
+    if (feasible && !cache.feasible[i])
+        cache.infeasible_n--;
+    else if (!feasible && cache.feasible[i])
+        cache.infeasible_n++;
+    cache.feasible[i] = feasible;
 }
 
-void HingeModel::HingeCollisionZone::RegisterSegment(HingeModel::Segment *segment)
+double HingeModel::ComputeGradient(adept::Stack &stack)
 {
-    segments_.insert(segment);
+    const size_t n = GetHingeCount();
+
+    // with a window most hinges stay put, so only the stencils around the moved ones
+    // are evaluated again
+    if (incremental_tolerance_ > 0.0 ||
+        (HasWindow() && gradient_backend_ == GradientBackend::Analytic))
+    {
+        // the penalty isn't part of the stencil cache, take it out before the update
+        for (size_t i = 0; i < boundary_gradient_.size() && i < n; i++)
+            hinges_.crossposition_gradient[i] -= boundary_gradient_[i];
+
+        last_score_ = IncrementalGradient() + BoundaryPenalty();
+        last_feasible_ = stencil_cache_.infeasible_n == 0;
+        evaluated_ = true;
+        return last_score_;
+    }
+
+    SetupEquations();
+
+    if (workers_ && n >= MIN_CHUNK_HINGES * chunks_.size())
+        last_score_ = ChunkedGradient();
+    else if (gradient_backend_ == GradientBackend::Analytic)
+        last_score_ = AnalyticGradient(0, n, hinges_.crossposition_gradient.data(),
+                                       hinges_.speed_gradient.data());
+    else
+        last_score_ = AdeptGradient(stack, 0, n, hinges_.crossposition_gradient.data(),
+                                    hinges_.speed_gradient.data());
+
+    last_score_ += BoundaryPenalty();
+    last_feasible_ = CheckFeasible();
+    evaluated_ = true;
+    return last_score_;
 }
 
-// ================ HINGE ================
+double HingeModel::StencilAcceleration(size_t i) const
+{
+    double dx = hinges_.position_x[i + 1] - hinges_.position_x[i];
+    double dy = hinges_.position_y[i + 1] - hinges_.position_y[i];
 
-HingeModel::Hinge::Hinge(HingeModel *model, Vector<2, false> position, double width,
-                         double forward)
-    : HingeModel::Segment(model, false, SDL2pp::Color(0, 255, 0)),
-      zero_position_(position), position_(position), crossposition_(0.0f), speed_(10.0),
-      width_(width), forward_(forward)
+    return std::abs(hinges_.speed[i] - hinges_.speed[i + 1]) /
+           std::sqrt(dx * dx + dy * dy);
+}
+
+bool HingeModel::CheckFeasible() const
 {
-    model->AddHinge(this);
+    for (size_t i = 1; i + 1 < GetHingeCount(); i++)
+    {
+        if (!(last_centrifugal_force_[i] < max_centrifugal_force_) ||
+            !(StencilAcceleration(i) < max_acceleration_))
+            return false;
+    }
+
+    return true;
 }
 
-void HingeModel::Hinge::SetupEquationsThis()
+bool HingeModel::SlowDownInfeasible()
 {
-    position_ = zero_position_ + crossposition_vector_ * crossposition_;
+    // stencils right at the barrier have huge gradients, so keep clear of it
+    const double margin = 0.9;
+
+    bool found = false;
+    for (size_t i = 1; i + 1 < GetHingeCount(); i++)
+    {
+        if (!(last_centrifugal_force_[i] < max_centrifugal_force_ * margin))
+        {
+            hinges_.speed[i] *= 0.95;
+            found = true;
+        }
+
+        if (!(StencilAcceleration(i) < max_acceleration_ * margin))
+        {
+            hinges_.speed[hinges_.speed[i] > hinges_.speed[i + 1] ? i : i + 1] *= 0.95;
+            found = true;
+        }
+    }
+
+    return found;
 }
 
-void HingeModel::Hinge::ComputeScoreThis(adept::aReal &score) const
+void HingeModel::NewtonStep()
 {
-    if (!next_ || !previous_)
+    const size_t n = GetHingeCount();
+
+    // unknowns 2i and 2i + 1 are the crossposition and the speed of hinge i
+    hessian_.Reset(2 * n);
+    const size_t size = hessian_.GetSize();
+    // Besides the endpoints, crosspositions held by the track bounds and those at the
+    // limits which the gradient pushes further out are kept in place. Otherwise the
+    // clamping would undo their part of the step and leave the rest of it unbalanced.
+    auto pinned = [this, n](size_t unknown) {
+        if (unknown >= 2 * n || unknown == 0 || unknown == 2 * (n - 1))
+            return true;
+
+        const size_t h = unknown / 2;
+        if (!InWindow(h))
+            return true;
+        if (unknown % 2 == 0 && h < held_.size() && held_[h])
+            return true;
+
+        return unknown % 2 == 0 && std::abs(hinges_.crossposition[h]) >= 1.0 &&
+               hinges_.crossposition[h] * hinges_.crossposition_gradient[h] < 0.0;
+    };
+
+    for (size_t i = 1; i + 1 < n; i++)
+    {
+        const hinge_kernel::Stencil stencil = {
+            {hinges_.position_x[i - 1], hinges_.position_y[i - 1]},
+            {hinges_.position_x[i], hinges_.position_y[i]},
+            {hinges_.position_x[i + 1], hinges_.position_y[i + 1]},
+            hinges_.speed[i],
+            hinges_.speed[i + 1]};
+        double directions[3][2];
+        for (int k = 0; k < 3; k++)
+        {
+            directions[k][0] = hinges_.crossposition_vector_x[i + k - 1];
+            directions[k][1] = hinges_.crossposition_vector_y[i + k - 1];
+        }
+
+        double hessian[5][5];
+        hinge_kernel::Hessian(stencil, directions, max_centrifugal_force_,
+                              max_acceleration_, hessian);
+
+        const size_t unknowns[5] = {2 * (i - 1), 2 * i, 2 * (i + 1), 2 * i + 1,
+                                    2 * (i + 1) + 1};
+        for (int a = 0; a < 5; a++)
+        {
+            for (int b = 0; b < 5; b++)
+            {
+                if (unknowns[a] <= unknowns[b] && !pinned(unknowns[a]) &&
+                    !pinned(unknowns[b]))
+                    hessian_.Add(unknowns[a], unknowns[b], hessian[a][b]);
+            }
+        }
+    }
+
+    newton_rhs_.assign(size, 0.0);
+    newton_shift_.resize(size);
+    for (size_t u = 0; u < size; u++)
+    {
+        if (pinned(u))
+        {
+            hessian_.Add(u, u, 1.0);
+            continue;
+        }
+
+        const size_t h = u / 2;
+        if (u % 2 == 0 && h < boundary_curvature_.size())
+            hessian_.Add(u, u, boundary_curvature_[h]);
+
+        newton_rhs_[u] =
+            u % 2 == 0 ? -hinges_.crossposition_gradient[h] : -hinges_.speed_gradient[h];
+    }
+
+    // Levenberg-Marquardt damping, measured in the same units as the gradient steps,
+    // raised until the damped Hessian is positive definite
+    bool factorized = false;
+    for (int attempt = 0; attempt < 30 && !factorized; attempt++)
+    {
+        for (size_t u = 0; u < size; u++)
+        {
+            const double unit = u % 2 == 0 ? 1.0 : speed_step_scale_;
+            newton_shift_[u] = pinned(u) ? 0.0 : newton_damping_ / unit;
+        }
+
+        factorized = hessian_.Factorize(newton_shift_);
+        if (!factorized)
+            newton_damping_ = std::max(newton_damping_ * 10.0, newton_initial_damping_);
+    }
+
+    if (!factorized)
+    {
+        log_.Warning() << "Hessian couldn't be factorized, not moving";
         return;
+    }
+
+    hessian_.Solve(newton_rhs_, newton_step_);
+
+    for (size_t i = 0; i < n; i++)
+    {
+        hinges_.speed[i] += newton_step_[2 * i + 1];
+
+        if (i > 0 && i + 1 < n)
+        {
+            double &cp = hinges_.crossposition[i];
+            cp += newton_step_[2 * i];
+
+            if (std::abs(cp) > 1.0)
+                cp /= std::abs(cp);
+        }
+    }
+}
 
-    Vector<2, true> position_diff_n =
-        (static_cast<Hinge *>(next_)->position_ - position_);
-    Vector<2, true> position_diff_p =
-        (position_ - static_cast<Hinge *>(previous_)->position_);
+const DistanceField &HingeModel::GetDistanceField() const
+{
+    if (!distance_field_built_)
+    {
+        distance_field_.Build(bounds_);
+        distance_field_built_ = true;
+        Log("HingeModel").Info() << "Distance field built, "
+                                 << distance_field_.GetTileCount() << " tiles";
+    }
 
-    adept::aReal len =
-        (adept::norm2(position_diff_n) + adept::norm2(position_diff_p)) / 2.0;
+    return distance_field_;
+}
 
-    adept::aReal r =
-        util::CircumcircleRadius(static_cast<Hinge *>(next_)->position_, position_,
-                                 static_cast<Hinge *>(previous_)->position_);
+double HingeModel::HingePenalty(size_t i, double &gradient, double &curvature) const
+{
+    gradient = curvature = 0.0;
+    if (!(boundary_penalty_ > 0.0) || bounds_.empty())
+        return 0.0;
+
+    const auto &h = hinges_;
+    const auto sample = GetDistanceField().Evaluate(
+        h.zero_x[i] + h.crossposition_vector_x[i] * h.crossposition[i],
+        h.zero_y[i] + h.crossposition_vector_y[i] * h.crossposition[i]);
+
+    const double depth = boundary_margin_ - sample.distance;
+    if (!(depth > 0.0))
+        return 0.0;
+
+    // derivative of the distance w.r.t. the crossposition, the field is taken as flat
+    const double slope = sample.gradient_x * h.crossposition_vector_x[i] +
+                         sample.gradient_y * h.crossposition_vector_y[i];
+    gradient = -2.0 * boundary_penalty_ * depth * slope;
+    curvature = 2.0 * boundary_penalty_ * slope * slope;
+    return boundary_penalty_ * depth * depth;
+}
 
-    adept::aReal centrifugal_force = (speed_ * speed_) / r;
+double HingeModel::BoundaryPenalty()
+{
+    const size_t n = GetHingeCount();
+    boundary_gradient_.assign(n, 0.0);
+    boundary_curvature_.assign(n, 0.0);
 
-    score += -0.2 / (centrifugal_force - model_->max_centrifugal_force_);
-    score += -0.2 / (adept::abs(speed_ - static_cast<Hinge *>(next_)->speed_) /
-                         adept::norm2(position_diff_n) -
-                     model_->max_acceleration_);
+    // the endpoints are pinned to the track centre
+    double score = 0.0;
+    for (size_t i = 1; i + 1 < n; i++)
+    {
+        score += HingePenalty(i, boundary_gradient_[i], boundary_curvature_[i]);
+        hinges_.crossposition_gradient[i] += boundary_gradient_[i];
+    }
 
-    last_centrifugal_force_ = centrifugal_force.value();
+    return score;
+}
 
-    score += len / speed_;
+CollisionGrid::Line HingeModel::HingeEdge(size_t i) const
+{
+    const auto &h = hinges_;
+    return {h.zero_x[i] + h.crossposition_vector_x[i] * h.crossposition[i],
+            h.zero_y[i] + h.crossposition_vector_y[i] * h.crossposition[i],
+            h.zero_x[i + 1] + h.crossposition_vector_x[i + 1] * h.crossposition[i + 1],
+            h.zero_y[i + 1] + h.crossposition_vector_y[i + 1] * h.crossposition[i + 1]};
 }
 
-void HingeModel::Hinge::ApplyGradientThis(double score_normalization)
+void HingeModel::UpdateEdgeCrossings()
 {
-    speed_ -= speed_.get_gradient() * model_->alpha_ * score_normalization * 200.0;
+    if (!collision_grid_built_)
+    {
+        collision_grid_.Build(bounds_);
+        collision_grid_built_ = true;
+    }
 
-    if (next_ && previous_)
+    const size_t n = GetHingeCount();
+    edge_crossing_.assign(n, 0);
+    size_t crossing_n = 0;
+    for (size_t i = 0; i + 1 < n; i++)
     {
-        crossposition_ -=
-            crossposition_.get_gradient() * model_->alpha_ * score_normalization;
+        edge_crossing_[i] = collision_grid_.Intersects(HingeEdge(i));
+        crossing_n += edge_crossing_[i];
+    }
+
+    if (crossing_n > 0)
+        log_.Info() << crossing_n << " hinge edges cross the track bounds";
+
+    edge_crossing_valid_ = true;
+}
 
-        if (adept::abs(crossposition_) > 1.0)
-            crossposition_ /= adept::abs(crossposition_);
+void HingeModel::KeepInsideBounds()
+{
+    const size_t n = GetHingeCount();
+    auto &cp = hinges_.crossposition;
+
+    step_edge_crossing_ = edge_crossing_;
+    held_.resize(n, 0);
+    pending_edges_.clear();
+    for (size_t i = 0; i + 1 < n; i++)
+    {
+        if (cp[i] != start_crossposition_[i] || cp[i + 1] != start_crossposition_[i + 1])
+            pending_edges_.push_back(i);
     }
 
-    vis_color_ = SpeedToColor(speed_.value());
+    while (!pending_edges_.empty())
+    {
+        const size_t i = pending_edges_.back();
+        pending_edges_.pop_back();
 
-    /*
-    auto from_collsion_zone = model_->CoordinatesToCollisionZone(GetPosition());
-    auto to_collsion_zone = model_->CoordinatesToCollisionZone(GetPosition());
+        step_edge_crossing_[i] = collision_grid_.Intersects(HingeEdge(i));
+        if (!step_edge_crossing_[i] || edge_crossing_[i])
+            continue;
 
-    Vector<2, true> old_position = Vector<2, true>(position_);
-        if (from_collsion_zone.first < 0 || to_collsion_zone.first >= model_->width_ ||
-            from_collsion_zone.second < 0 || to_collsion_zone.second >= model_->height_)
+        // move both ends back, which may make their other edges cross instead
+        for (size_t h : {i, i + 1})
         {
-            model_->log_.Error() << "Hinge overflows the board";
-            return;
+            if (cp[h] == start_crossposition_[h])
+                continue;
+
+            cp[h] = start_crossposition_[h];
+            held_[h] = 1;
+            if (h > 0)
+                pending_edges_.push_back(h - 1);
+            if (h + 1 < n)
+                pending_edges_.push_back(h);
         }
+    }
+}
+
+double HingeModel::GradientNorm() const
+{
+    const size_t n = GetHingeCount();
+    const double speed_unit = std::sqrt(speed_step_scale_);
+
+    // same parameters as the optimizer sees, the pinned endpoints and the hinges outside
+    // the window don't count
+    double norm = 0.0;
+    for (size_t i = 0; i < n; i++)
+    {
+        if (!InWindow(i))
+            continue;
+
+        const double speed_gradient = hinges_.speed_gradient[i] * speed_unit;
+        norm += speed_gradient * speed_gradient;
+
+        if (i > 0 && i + 1 < n)
+            norm += hinges_.crossposition_gradient[i] * hinges_.crossposition_gradient[i];
+    }
+
+    return std::sqrt(norm);
+}
+
+double HingeModel::ProposeStep()
+{
+    const size_t n = GetHingeCount();
+
+    hinges_.crossposition = start_crossposition_;
+    hinges_.speed = start_speed_;
+    ApplyGradientThis(1.0);
+    elements_.ApplyGradient(1.0);
+
+    double slope = 0.0;
+    for (size_t i = 0; i < n; i++)
+    {
+        step_crossposition_[i] = hinges_.crossposition[i] - start_crossposition_[i];
+        step_speed_[i] = hinges_.speed[i] - start_speed_[i];
+
+        slope += hinges_.crossposition_gradient[i] * step_crossposition_[i] +
+                 hinges_.speed_gradient[i] * step_speed_[i];
+    }
+
+    return slope;
+}
+
+void HingeModel::MoveAlongStep(double scale)
+{
+    for (size_t i = 0; i < GetHingeCount(); i++)
+    {
+        double &cp = hinges_.crossposition[i];
+        cp = start_crossposition_[i] + scale * step_crossposition_[i];
+
+        if (std::abs(cp) > 1.0)
+            cp /= std::abs(cp);
+
+        hinges_.speed[i] = start_speed_[i] + scale * step_speed_[i];
+    }
+}
 
-        for (int czx = from_collsion_zone.first; czx < to_collsion_zone.first + 1; czx++)
+bool HingeModel::Optimize(adept::Stack &stack)
+{
+    if (converged_)
+        return true;
+
+    if (!evaluated_)
+        ComputeGradient(stack);
+
+    if (!last_feasible_)
+    {
+        // the line search only moves between states inside the barriers
+        EnforceLimits();
+        ComputeGradient(stack);
+    }
+
+    const double score = last_score_;
+
+    if (boundary_collisions_ && !edge_crossing_valid_)
+        UpdateEdgeCrossings();
+
+    if (GradientNorm() <= convergence_gradient_norm_)
+    {
+        log_.Info() << "Optimization converged, gradient vanished, score = " << score;
+        converged_ = !StartPolishing();
+        return converged_;
+    }
+
+    start_crossposition_ = hinges_.crossposition;
+    start_speed_ = hinges_.speed;
+    step_crossposition_.resize(GetHingeCount());
+    step_speed_.resize(GetHingeCount());
+
+    double slope = ProposeStep();
+    if (!(slope < 0.0))
+    {
+        // momentum may carry the optimizer uphill, start over from a descent step
+        log_.Warning() << "Proposed step doesn't descend, resetting the optimizer";
+        ResetOptimizer();
+        slope = ProposeStep();
+    }
+
+    // Newton steps already have the right length
+    const double max_scale = newton_ ? 1.0 : line_search_max_scale_;
+    double scale = std::min(max_scale, 2.0 * step_scale_);
+    int backtracks = 0;
+    while (true)
+    {
+        MoveAlongStep(scale);
+        if (boundary_collisions_)
+            KeepInsideBounds();
+        ComputeGradient(stack);
+
+        if (last_feasible_ && last_score_ <= score + line_search_c1_ * scale * slope)
+            break;
+
+        if (++backtracks > line_search_backtracks_)
         {
-            for (int czy = from_collsion_zone.second; czy < to_collsion_zone.second + 1;
-                 czy++)
-            {
-                if (model_->collision_zones_[czx][czy]->Collides(this) ||
-                    model_->collision_zones_[czx][czy]->Collides(previous_))
-                {
-                    position_ = old_position;
-                    return;
-                }
-            }
+            // Nothing along the proposed step is good enough, stay put and let the
+            // optimizer start over. A failure counts as a step without improvement.
+            log_.Warning() << "Line search failed, resetting the optimizer";
+            MoveAlongStep(0.0);
+            ComputeGradient(stack);
+            ResetOptimizer();
+            held_.clear();
+            scale = 0.0;
+            break;
         }
-    */
+
+        scale /= 2.0;
+    }
+
+    if (scale > 0.0)
+    {
+        step_scale_ = scale;
+        if (boundary_collisions_)
+            edge_crossing_.swap(step_edge_crossing_);
+    }
+
+    // trust the quadratic model more while its steps are taken as they are
+    if (newton_ && scale > 0.0)
+        newton_damping_ *= backtracks == 0 ? 0.5 : 4.0;
+
+    const double score_scale =
+        std::max(std::abs(score), std::numeric_limits<double>::min());
+    const double improvement = (score - last_score_) / score_scale;
+    stalled_steps_ =
+        improvement < convergence_relative_improvement_ ? stalled_steps_ + 1 : 0;
+
+    log_.Info() << "Optimization step done, score = " << last_score_
+                << ", step scale = " << scale;
+
+    if (stalled_steps_ >= convergence_steps_)
+    {
+        log_.Info() << "Optimization converged, score stopped improving, score = "
+                    << last_score_;
+        converged_ = !StartPolishing();
+    }
+
+    return converged_;
 }
 
-void HingeModel::Hinge::LinkForward(Segment *next)
+double HingeModel::GetScore() const { return last_score_; }
+
+bool HingeModel::IsFeasible() const { return last_feasible_; }
+
+void HingeModel::Snapshot(RacingLine &line) const
 {
-    Segment::LinkForward(next);
-    Vector<2, true> heading = next_->GetPosition() - position_;
-    heading /= adept::norm2(heading);
-    crossposition_vector_ =
-        Vector<2, false>({{-heading[0][1].value(), heading[0][0].value()}}) * width_;
+    const size_t n = GetHingeCount();
+
+    line.forward = hinges_.forward;
+    line.crossposition = hinges_.crossposition;
+    line.speed = hinges_.speed;
+    line.crossposition_vector_x = hinges_.crossposition_vector_x;
+    line.crossposition_vector_y = hinges_.crossposition_vector_y;
+
+    // positions may lag behind the crosspositions until the next evaluation
+    line.position_x.resize(n);
+    line.position_y.resize(n);
+    for (size_t i = 0; i < n; i++)
+    {
+        line.position_x[i] =
+            hinges_.zero_x[i] +
+            hinges_.crossposition_vector_x[i] * hinges_.crossposition[i];
+        line.position_y[i] =
+            hinges_.zero_y[i] +
+            hinges_.crossposition_vector_y[i] * hinges_.crossposition[i];
+    }
 
-    position_ = zero_position_;
+    if (line.hinges.size() != n)
+    {
+        line.hinges.clear();
+        for (size_t i = 0; i < n; i++)
+            line.hinges.emplace_back(&line, i);
+    }
 }
 
-std::string HingeModel::Hinge::GetTooltip() const
+void HingeModel::VisualiseBands(std::vector<Visualisation::Object> &objects) const
 {
-    std::stringstream ret;
-    ret << "Hinge | position = " << position_;
-    ret << ", speed = " << speed_;
-    ret << ", centrifugal_force = " << last_centrifugal_force_;
-    ret << ", crossposition = " << crossposition_;
-    ret << ", crossposition_vector = " << crossposition_vector_;
+    elements_.Visualise(objects);
+}
 
-    return ret.str();
+HingeModel::Precision HingeModel::GetPrecision() const
+{
+    return polishing_ ? Precision::Double : precision_;
 }
 
-Vector<2, false> HingeModel::Hinge::GetPosition() const
+HingeModel::GradientBackend HingeModel::GetGradientBackend() const
 {
-    return Vector<2, true>(position_).inactive_link();
+    return gradient_backend_;
 }
 
-double HingeModel::Hinge::GetCrossposition() const { return crossposition_.value(); }
+size_t HingeModel::GetHingeCount() const { return hinges_.speed.size(); }
 
-double HingeModel::Hinge::GetSpeed() const { return speed_.value(); }
+HingeModel::Hinge HingeModel::GetHinge(size_t index) const { return Hinge(this, index); }
 
-double HingeModel::Hinge::GetForward() const { return forward_; }
+const std::vector<double> &HingeModel::GetCrosspositions() const
+{
+    return hinges_.crossposition;
+}
+
+const std::vector<double> &HingeModel::GetSpeeds() const { return hinges_.speed; }
+
+const std::vector<double> &HingeModel::GetForwards() const { return hinges_.forward; }
 
-HingeModel::Hinge *HingeModel::Hinge::GetNext() const
+void HingeModel::SetCrossposition(size_t index, double cp)
 {
-    return static_cast<Hinge *>(next_);
+    StateChanged();
+    hinges_.crossposition[index] = cp;
 }
 
-HingeModel::Hinge *HingeModel::Hinge::GetPrevious() const
+void HingeModel::SetSpeed(size_t index, double speed)
 {
-    return static_cast<Hinge *>(previous_);
+    StateChanged();
+    hinges_.speed[index] = speed;
 }
 
-Vector<2, false> HingeModel::Hinge::GetCrosspositionVector() const
+void HingeModel::SetState(const double *crosspositions, const double *speeds)
+{
+    StateChanged();
+    const size_t n = GetHingeCount();
+    hinges_.crossposition.assign(crosspositions, crosspositions + n);
+    hinges_.speed.assign(speeds, speeds + n);
+}
+
+void HingeModel::InterpolateFrom(const HingeModel &other)
+{
+    const size_t n = GetHingeCount();
+    const auto &other_forward = other.hinges_.forward;
+    ASSERT(other.GetHingeCount() > 1, "Can't interpolate from less than two hinges");
+
+    size_t j = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        const double forward = hinges_.forward[i];
+        while (j + 2 < other_forward.size() && other_forward[j + 1] < forward)
+            j++;
+
+        double t =
+            (forward - other_forward[j]) / (other_forward[j + 1] - other_forward[j]);
+        t = std::min(1.0, std::max(0.0, t));
+
+        hinges_.speed[i] =
+            (1.0 - t) * other.hinges_.speed[j] + t * other.hinges_.speed[j + 1];
+
+        // the first and the last hinge are pinned to the track centre
+        if (i > 0 && i + 1 < n)
+        {
+            hinges_.crossposition[i] = (1.0 - t) * other.hinges_.crossposition[j] +
+                                       t * other.hinges_.crossposition[j + 1];
+        }
+    }
+
+    // A finer chain follows the curves more closely than the one it was interpolated
+    // from, so some of its stencils may end up outside the barriers.
+    EnforceLimits();
+}
+
+void HingeModel::SetWindow(size_t first, size_t end)
 {
-    return crossposition_vector_;
+    if (first == window_first_ && end == window_end_)
+        return;
+
+    window_first_ = first;
+    window_end_ = end;
+
+    // the optimizer's history belongs to the previous set of free hinges, which may
+    // have converged while the new ones haven't
+    ResetOptimizer();
+    converged_ = false;
+    stalled_steps_ = 0;
 }
 
-void HingeModel::Hinge::SetCrossposition(double cp) { crossposition_ = cp; }
+bool HingeModel::InWindow(size_t i) const
+{
+    // hinge i comes around again as i + n on the next lap
+    const size_t n = GetHingeCount();
+    return (i >= window_first_ && i < window_end_) ||
+           (i + n >= window_first_ && i + n < window_end_);
+}
 
-void HingeModel::Hinge::SetSpeed(double speed) { speed_ = speed; }
+bool HingeModel::HasWindow() const
+{
+    return window_end_ - window_first_ < GetHingeCount();
+}
 
-SDL2pp::Color HingeModel::Hinge::SpeedToColor(double speed)
+void HingeModel::EnforceLimits()
+{
+    // slowing down brings both the centrifugal force and the acceleration back
+    for (int attempt = 0; attempt < 1000; attempt++)
+    {
+        SetupEquationsThis();
+        AnalyticGradient(0, GetHingeCount(), hinges_.crossposition_gradient.data(),
+                         hinges_.speed_gradient.data());
+
+        if (!SlowDownInfeasible())
+        {
+            StateChanged();
+            return;
+        }
+    }
+
+    StateChanged();
+    log_.Warning() << "Couldn't bring the model inside the limits";
+}
+
+SDL2pp::Color HingeModel::SpeedToColor(double speed)
 {
     if (speed > 255.0)
         return SDL2pp::Color(0, 255, 0);
@@ -288,12 +1333,79 @@ SDL2pp::Color HingeModel::Hinge::SpeedToColor(double speed)
         return SDL2pp::Color(0, speed, 0);
 }
 
+// ================ HINGE ================
+
+HingeModel::Hinge::Hinge(const HingeModel *model, size_t index)
+    : model_(model), index_(index)
+{
+}
+
+std::string HingeModel::Hinge::GetTooltip() const
+{
+    std::stringstream ret;
+    ret << "Hinge | position = " << GetPosition();
+    ret << ", speed = " << GetSpeed();
+    ret << ", centrifugal_force = " << model_->last_centrifugal_force_[index_];
+    ret << ", crossposition = " << GetCrossposition();
+    ret << ", crossposition_vector = " << GetCrosspositionVector();
+
+    return ret.str();
+}
+
+size_t HingeModel::Hinge::GetIndex() const { return index_; }
+
+Vector<2, false> HingeModel::Hinge::GetPosition() const
+{
+    return Vector<2, false>(
+        {{model_->hinges_.position_x[index_], model_->hinges_.position_y[index_]}});
+}
+
+double HingeModel::Hinge::GetCrossposition() const
+{
+    return model_->hinges_.crossposition[index_];
+}
+
+double HingeModel::Hinge::GetSpeed() const { return model_->hinges_.speed[index_]; }
+
+double HingeModel::Hinge::GetForward() const { return model_->hinges_.forward[index_]; }
+
+Vector<2, false> HingeModel::Hinge::GetCrosspositionVector() const
+{
+    return Vector<2, false>({{model_->hinges_.crossposition_vector_x[index_],
+                              model_->hinges_.crossposition_vector_y[index_]}});
+}
+
+double HingeModel::Hinge::GetCrosspositionGradient() const
+{
+    return model_->hinges_.crossposition_gradient[index_];
+}
+
+double HingeModel::Hinge::GetSpeedGradient() const
+{
+    return model_->hinges_.speed_gradient[index_];
+}
+
 // ================ BAND_SEGMENT ================
 
-HingeModel::BandSegement::BandSegement(HingeModel *model, Vector<2, false> position)
-    : HingeModel::Segment(model, true, SDL2pp::Color(255, 0, 0)), position_(position)
+HingeModel::BandSegement::BandSegement(HingeModel *model, Vector<2, false> position,
+                                       Side side)
+    : HingeModel::Segment(model, true, SDL2pp::Color(255, 0, 0)), position_(position),
+      side_(side)
 {
-    model->AddBandSegment(this);
+}
+
+void HingeModel::BandSegement::LinkForward(Segment *next)
+{
+    Segment::LinkForward(next);
+
+    // bounds are kept with the track on their left
+    auto from = GetPosition(), to = next->GetPosition();
+    if (side_ == Side::Left)
+        std::swap(from, to);
+
+    model_->bounds_.push_back({from(0, 0), from(0, 1), to(0, 0), to(0, 1)});
+    model_->collision_grid_built_ = false;
+    model_->distance_field_built_ = false;
 }
 
 void HingeModel::BandSegement::SetupEquationsThis() {}
@@ -329,26 +1441,6 @@ void HingeModel::Segment::LinkForward(HingeModel::Segment *next)
 {
     next_ = next;
     next->LinkBackward(this);
-
-    if (solid_)
-    {
-        auto collison_zone_coords = model_->CoordinatesToCollisionZone(GetPosition());
-
-        if (collison_zone_coords.first >= model_->width_ ||
-            collison_zone_coords.second >= model_->height_ ||
-            collison_zone_coords.first < 0 || collison_zone_coords.second < 0)
-        {
-            model_->log_.Error() << "Track doesn't fit in the board";
-            throw std::runtime_error("");
-        }
-        else
-        {
-            model_
-                ->collision_zones_[collison_zone_coords.first]
-                                  [collison_zone_coords.second]
-                ->RegisterSegment(this);
-        }
-    }
 }
 
 void HingeModel::Segment::LinkBackward(HingeModel::Segment *previous)
@@ -25,11 +25,13 @@ LoggingSingleton::LoggingSingleton()
 
 void LoggingSingleton::SetConsoleVerbosity(bool verbose)
 {
+    std::lock_guard<std::mutex> lock(mutex_);
     sinks_[0]->set_level(verbose ? spdlog::level::debug : spdlog::level::info);
 }
 
 void LoggingSingleton::AddLogFile(std::string name)
 {
+    std::lock_guard<std::mutex> lock(mutex_);
     auto file_sink =
         std::make_shared<spdlog::sinks::basic_file_sink_mt>(name, true);
 
@@ -42,6 +44,15 @@ void LoggingSingleton::AddLogFile(std::string name)
 std::shared_ptr<spdlog::logger>
 LoggingSingleton::RegisterModule(std::string name)
 {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // reuse the logger of the module, it is only recreated after the sinks change
+    for (const auto &handle : handles_)
+    {
+        if (handle->name() == name)
+            return handle;
+    }
+
     std::shared_ptr<spdlog::logger> ret = std::make_shared<spdlog::logger>(
         name, std::begin(sinks_), std::end(sinks_));
 
@@ -1,11 +1,17 @@
+#include <chrono>
 #include <stdio.h>
+#include <thread>
 
+#include "background_optimizer.h"
 #include "config.h"
+#include "config_watcher.h"
 #include "data_reader.h"
 #include "executor.h"
 #include "hinge_model.h"
 #include "integration.h"
 #include "log.h"
+#include "multiresolution.h"
+#include "multistart.h"
 #include "visualisation.h"
 
 using std::string;
@@ -51,9 +57,9 @@ int main(int argc, char **argv)
         auto track_start = Vector<2, false>({{double(model_size_x) * model_cell / 2.0,
                                               double(model_size_y) * model_cell / 2.0}});
 
-        HingeModel model(model_size_x, model_size_y, model_cell);
-        DataReader::ReadTORCSTrack(Config::inst().GetOption<string>("track"), model,
-                                   track_start);
+        const auto track_path = Config::inst().GetOption<string>("track");
+        HingeModel model;
+        DataReader::ReadTORCSTrackCached(track_path, model, track_start);
 
         if (Config::inst().GetOption<string>("model_path") != "")
         {
@@ -65,42 +71,57 @@ int main(int argc, char **argv)
             score = ascore.value();
             log.Info() << "Loaded hinge model. Its score is " << score << ".";
         }
+        else if (Config::inst().GetOption<int>("multistart_models") > 1)
+        {
+            score = MultiStart::Run(DataReader::ParseTORCSTrack(track_path), track_start,
+                                    model, main_stack);
+        }
+        else if (Config::inst().GetOption<int>("multires_levels") > 1)
+        {
+            Multiresolution::WarmStart(DataReader::ParseTORCSTrack(track_path),
+                                       track_start, model, main_stack);
+        }
 
         std::unique_ptr<TorcsIntegration> integration;
-        ExecutorRacing executor(model);
+        ExecutorRacing executor;
+        BackgroundOptimizer optimizer(model, score);
+
+        // Edits of the configuration file reach score_threshold, forward_boost and
+        // cross_safety_margin while racing, everything else is read once at startup.
+        std::unique_ptr<ConfigWatcher> config_watcher;
+        if (config_path != "")
+            config_watcher = std::make_unique<ConfigWatcher>(config_path);
+        uint64_t config_version = 0;
+        float score_threshold = Config::inst().GetOption<float>("score_threshold");
 
         if (vis)
             vis->SetCameraPos(track_start);
 
-        bool optimization_paused = true;
         bool exit_requested = false;
         CarState car_state;
 
         while (!exit_requested)
         {
-            if (!optimization_paused)
+            // nothing but a check unless the file was reloaded
+            if (config_watcher)
             {
-                for (int i = 0;
-                     i < Config::inst().GetOption<int>("optimizations_per_frame"); i++)
+                const auto &config = config_watcher->Read();
+                if (config.version != config_version)
                 {
-                    score = model.Optimize(main_stack);
+                    config_version = config.version;
+                    score_threshold = config.GetOption<float>("score_threshold");
+                    executor.Reconfigure(config);
                 }
             }
-            else
-            {
-                main_stack.new_recording();
-            }
 
-            if (!integration &&
-                score <= Config::inst().GetOption<float>("score_threshold"))
-            {
-                auto track_name = Config::inst().GetOption<string>("track");
-                std::replace(track_name.begin(), track_name.end(), '/', '_');
+            // the model belongs to the optimizer thread now, only its copies are used
+            const auto &racing_line = optimizer.GetRacingLine();
+            executor.SetRacingLine(racing_line);
 
+            if (!integration && racing_line.score <= score_threshold)
+            {
                 DataReader::SaveHingeModel(
-                    Config::inst().GetOption<string>("save_model_path_prefix") +
-                        track_name + "_" + std::to_string(score) + ".hinges",
-                    model);
+                    DataReader::DefaultHingeModelPath(racing_line.score), racing_line);
 
                 integration = std::make_unique<TorcsIntegration>();
                 car_state = integration->Begin();
@@ -110,13 +131,20 @@ int main(int argc, char **argv)
             {
                 auto steers = executor.Cycle(car_state, 1.0);
                 car_state = integration->Cycle(steers);
+                optimizer.SetFocus(executor.GetCurrentHinge());
+            }
+            else if (!vis)
+            {
+                // nothing paces the loop, don't take the CPU from the optimizer
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
             }
 
             if (vis)
             {
                 std::vector<Visualisation::Object> objects;
 
-                model.Visualise(objects);
+                model.VisualiseBands(objects);
+                racing_line.Visualise(objects);
                 executor.Visualise(objects);
                 vis->Tick(objects);
 
@@ -128,7 +156,7 @@ int main(int argc, char **argv)
                         exit_requested = true;
                         break;
                     case Visualisation::OptimizationPause:
-                        optimization_paused = !optimization_paused;
+                        optimizer.SetPaused(!optimizer.IsPaused());
                         break;
                     default:
                         ASSERT(0, "Action not implemented!")
@@ -0,0 +1,31 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "exceptions.h"
+#include "mapped_file.h"
+
+MappedFile::MappedFile(const std::string &path) : data_(nullptr), size_(0)
+{
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw Exception("Couldn't open " + path);
+
+    struct stat status;
+    if (fstat(fd, &status) == 0 && status.st_size > 0)
+    {
+        size_ = status.st_size;
+        data_ = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+
+    if (!data_ || data_ == MAP_FAILED)
+        throw Exception("Couldn't map " + path);
+}
+
+MappedFile::~MappedFile() { munmap(data_, size_); }
+
+const void *MappedFile::GetData() const { return data_; }
+
+size_t MappedFile::GetSize() const { return size_; }
@@ -0,0 +1,38 @@
+#include <cmath>
+
+#include "multiresolution.h"
+#include "config.h"
+
+void Multiresolution::WarmStart(const Track &track, Vector<2, false> startpoint,
+                                HingeModel &model, adept::Stack &stack)
+{
+    Log log{"Multiresolution"};
+
+    const int levels = Config::inst().GetOption<int>("multires_levels");
+    const float factor = Config::inst().GetOption<float>("multires_factor");
+    const int iterations = Config::inst().GetOption<int>("multires_iterations");
+
+    std::unique_ptr<HingeModel> previous;
+    for (int level = levels - 1; level > 0; level--)
+    {
+        auto current = std::make_unique<HingeModel>();
+        DataReader::BuildHingeModel(track, *current, startpoint, std::pow(factor, level));
+
+        if (previous)
+            current->InterpolateFrom(*previous);
+
+        for (int i = 0; i < iterations; i++)
+        {
+            if (current->Optimize(stack))
+                break;
+        }
+
+        log.Info() << "Level " << level << " with " << current->GetHingeCount()
+                   << " hinges done, score = " << current->GetScore();
+
+        previous = std::move(current);
+    }
+
+    if (previous)
+        model.InterpolateFrom(*previous);
+}
@@ -0,0 +1,123 @@
+#include <cmath>
+#include <limits>
+#include <random>
+
+#include "multistart.h"
+#include "config.h"
+#include "worker_pool.h"
+
+namespace
+{
+void CopyLine(const HingeModel &from, HingeModel &to)
+{
+    ASSERT(from.GetHingeCount() == to.GetHingeCount(), "Models of different tracks");
+
+    for (size_t i = 0; i < from.GetHingeCount(); i++)
+    {
+        to.SetCrossposition(i, from.GetCrosspositions()[i]);
+        to.SetSpeed(i, from.GetSpeeds()[i]);
+    }
+}
+}
+
+double MultiStart::Run(const Track &track, Vector<2, false> startpoint, HingeModel &model,
+                       adept::Stack &stack)
+{
+    Log log{"MultiStart"};
+
+    const int models_n = Config::inst().GetOption<int>("multistart_models");
+    const int threads = Config::inst().GetOption<int>("multistart_threads");
+    const int iterations = Config::inst().GetOption<int>("multistart_iterations");
+    const float alpha_spread = Config::inst().GetOption<float>("multistart_alpha_spread");
+    const float force_spread = Config::inst().GetOption<float>("multistart_force_spread");
+    const float speed_spread = Config::inst().GetOption<float>("multistart_speed_spread");
+    const float crossposition_jitter =
+        Config::inst().GetOption<float>("multistart_crossposition_jitter");
+    const int seed = Config::inst().GetOption<int>("multistart_seed");
+
+    const auto defaults = HingeModel::Hyperparameters::FromConfig();
+
+    std::vector<std::unique_ptr<HingeModel>> candidates;
+    for (int k = 0; k < models_n; k++)
+    {
+        std::mt19937 rng(seed + k);
+        std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+        // alphas spread evenly on the log scale in [alpha / spread, alpha * spread]
+        const double t = models_n > 1 ? double(k) / (models_n - 1) : 0.5;
+        auto hyperparameters = defaults;
+        hyperparameters.alpha *= std::pow(alpha_spread, 2.0 * t - 1.0);
+        hyperparameters.max_centrifugal_force *= 1.0 - force_spread * unit(rng);
+        // the candidates already run in parallel, so they don't get worker pools
+        hyperparameters.optimizer_threads = 1;
+
+        auto candidate = std::make_unique<HingeModel>(hyperparameters);
+        DataReader::BuildHingeModel(track, *candidate, startpoint);
+
+        const double speed_factor = 1.0 + speed_spread * unit(rng);
+        for (size_t i = 0; i < candidate->GetHingeCount(); i++)
+        {
+            candidate->SetSpeed(i, candidate->GetSpeeds()[i] * speed_factor);
+            if (i > 0 && i + 1 < candidate->GetHingeCount())
+                candidate->SetCrossposition(
+                    i, crossposition_jitter * (2.0 * unit(rng) - 1.0));
+        }
+
+        candidate->EnforceLimits();
+        candidate->ResetOptimizer();
+        candidates.push_back(std::move(candidate));
+
+        log.Info() << "Candidate " << k << ": alpha = " << hyperparameters.alpha
+                   << ", max_centrifugal_force = "
+                   << hyperparameters.max_centrifugal_force
+                   << ", initial speed factor = " << speed_factor;
+    }
+
+    {
+        WorkerPool workers(threads);
+        workers.Run(models_n, [&candidates, iterations](size_t k) {
+            static thread_local adept::Stack worker_stack;
+            for (int i = 0; i < iterations; i++)
+            {
+                if (candidates[k]->Optimize(worker_stack))
+                    break;
+            }
+        });
+    }
+
+    SelectBest(candidates, model, stack);
+    const double best_score = model.ComputeGradient(stack);
+    DataReader::SaveHingeModel(DataReader::DefaultHingeModelPath(best_score), model);
+
+    return best_score;
+}
+
+size_t MultiStart::SelectBest(const std::vector<std::unique_ptr<HingeModel>> &candidates,
+                              HingeModel &model, adept::Stack &stack)
+{
+    Log log{"MultiStart"};
+
+    // candidates optimized different objectives, so rank them by the configured one
+    int best = -1;
+    double best_score = std::numeric_limits<double>::infinity();
+    for (size_t k = 0; k < candidates.size(); k++)
+    {
+        CopyLine(*candidates[k], model);
+        double score = model.ComputeGradient(stack);
+
+        log.Info() << "Candidate " << k << " scored " << score
+                   << (model.IsFeasible() ? "" : " outside the limits");
+
+        if (model.IsFeasible() && score < best_score)
+        {
+            best = k;
+            best_score = score;
+        }
+    }
+
+    ASSERT(best >= 0, "No candidate ended up inside the limits");
+    log.Info() << "Candidate " << best << " is the best one, score = " << best_score;
+
+    CopyLine(*candidates[best], model);
+    return best;
+}
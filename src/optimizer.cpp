@@ -0,0 +1,210 @@
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+#include "optimizer.h"
+#include "config.h"
+#include "exceptions.h"
+
+Optimizer::Optimizer(size_t size, double alpha) : size_(size), alpha_(alpha) {}
+
+size_t Optimizer::GetSize() const { return size_; }
+
+std::unique_ptr<Optimizer> Optimizer::Create(size_t size)
+{
+    return Create(size, Config::inst().GetOption<float>("alpha"));
+}
+
+std::unique_ptr<Optimizer> Optimizer::Create(size_t size, double alpha)
+{
+    auto name = Config::inst().GetOption<std::string>("optimizer");
+
+    if (name == "sgd")
+        return std::make_unique<SgdOptimizer>(size, alpha);
+    else if (name == "momentum")
+        return std::make_unique<MomentumOptimizer>(size, alpha);
+    else if (name == "adam")
+        return std::make_unique<AdamOptimizer>(size, alpha);
+    else if (name == "lbfgs")
+        return std::make_unique<LbfgsOptimizer>(size, alpha);
+
+    throw Exception("Unknown optimizer: " + name);
+}
+
+// ================ SGD ================
+
+SgdOptimizer::SgdOptimizer(size_t size, double alpha) : Optimizer(size, alpha) {}
+
+void SgdOptimizer::Step(double score, const std::vector<double> &gradient,
+                        std::vector<double> &parameters)
+{
+    for (size_t i = 0; i < size_; i++)
+        parameters[i] -= alpha_ * gradient[i];
+}
+
+// ================ MOMENTUM ================
+
+MomentumOptimizer::MomentumOptimizer(size_t size, double alpha)
+    : Optimizer(size, alpha), momentum_(Config::inst().GetOption<float>("momentum")),
+      velocity_(size, 0.0)
+{
+}
+
+void MomentumOptimizer::Step(double score, const std::vector<double> &gradient,
+                             std::vector<double> &parameters)
+{
+    for (size_t i = 0; i < size_; i++)
+    {
+        velocity_[i] = momentum_ * velocity_[i] - alpha_ * gradient[i];
+        parameters[i] += velocity_[i];
+    }
+}
+
+// ================ ADAM ================
+
+AdamOptimizer::AdamOptimizer(size_t size, double alpha)
+    : Optimizer(size, alpha), beta1_(Config::inst().GetOption<float>("adam_beta1")),
+      beta2_(Config::inst().GetOption<float>("adam_beta2")),
+      epsilon_(Config::inst().GetOption<float>("adam_epsilon")), beta1_power_(1.0),
+      beta2_power_(1.0), first_moment_(size, 0.0), second_moment_(size, 0.0)
+{
+}
+
+void AdamOptimizer::Step(double score, const std::vector<double> &gradient,
+                         std::vector<double> &parameters)
+{
+    beta1_power_ *= beta1_;
+    beta2_power_ *= beta2_;
+
+    // bias corrections folded into the step size
+    const double step = alpha_ * std::sqrt(1.0 - beta2_power_) / (1.0 - beta1_power_);
+    const double epsilon = epsilon_ * std::sqrt(1.0 - beta2_power_);
+
+    for (size_t i = 0; i < size_; i++)
+    {
+        const double g = gradient[i];
+        first_moment_[i] = beta1_ * first_moment_[i] + (1.0 - beta1_) * g;
+        second_moment_[i] = beta2_ * second_moment_[i] + (1.0 - beta2_) * g * g;
+
+        parameters[i] -=
+            step * first_moment_[i] / (std::sqrt(second_moment_[i]) + epsilon);
+    }
+}
+
+// ================ L-BFGS ================
+
+LbfgsOptimizer::LbfgsOptimizer(size_t size, double alpha)
+    : Optimizer(size, alpha), history_(Config::inst().GetOption<int>("lbfgs_history")),
+      s_(history_ * size), y_(history_ * size), rho_(history_), pairs_n_(0), newest_(0),
+      previous_parameters_(size), previous_gradient_(size), direction_(size),
+      coefficients_(history_), previous_score_(0.0), step_(1.0), started_(false)
+{
+    ASSERT(history_ > 0, "L-BFGS needs a history of at least one pair");
+}
+
+void LbfgsOptimizer::ComputeDirection(const std::vector<double> &gradient)
+{
+    // plain gradient step until curvature information is available
+    if (pairs_n_ == 0)
+    {
+        for (size_t i = 0; i < size_; i++)
+            direction_[i] = -alpha_ * gradient[i];
+        return;
+    }
+
+    auto row = [this](std::vector<double> &v, size_t age) {
+        return v.data() + ((newest_ + history_ - age) % history_) * size_;
+    };
+
+    // two-loop recursion, direction_ = -H * gradient
+    for (size_t i = 0; i < size_; i++)
+        direction_[i] = -gradient[i];
+
+    for (size_t age = 0; age < pairs_n_; age++)
+    {
+        const double *s = row(s_, age), *y = row(y_, age);
+        const size_t r = (newest_ + history_ - age) % history_;
+
+        coefficients_[r] =
+            rho_[r] * std::inner_product(s, s + size_, direction_.begin(), 0.0);
+        for (size_t i = 0; i < size_; i++)
+            direction_[i] -= coefficients_[r] * y[i];
+    }
+
+    // initial Hessian approximation scaled by the newest pair
+    const double *s = row(s_, 0), *y = row(y_, 0);
+    const double gamma = std::inner_product(s, s + size_, y, 0.0) /
+                         std::inner_product(y, y + size_, y, 0.0);
+    for (size_t i = 0; i < size_; i++)
+        direction_[i] *= gamma;
+
+    for (size_t age = pairs_n_; age-- > 0;)
+    {
+        const double *s = row(s_, age), *y = row(y_, age);
+        const size_t r = (newest_ + history_ - age) % history_;
+
+        const double beta =
+            rho_[r] * std::inner_product(y, y + size_, direction_.begin(), 0.0);
+        for (size_t i = 0; i < size_; i++)
+            direction_[i] += (coefficients_[r] - beta) * s[i];
+    }
+}
+
+void LbfgsOptimizer::Step(double score, const std::vector<double> &gradient,
+                          std::vector<double> &parameters)
+{
+    if (started_ && !(score <= previous_score_))
+    {
+        // take the step back and retry a shorter one; if that doesn't help either the
+        // curvature pairs are misleading, so start over from a gradient step
+        step_ /= 2.0;
+        if (step_ < 1e-6 && pairs_n_ > 0)
+        {
+            log_.Warning() << "Step doesn't decrease the score, dropping history";
+            pairs_n_ = 0;
+            step_ = 1.0;
+            ComputeDirection(previous_gradient_);
+        }
+
+        for (size_t i = 0; i < size_; i++)
+            parameters[i] = previous_parameters_[i] + step_ * direction_[i];
+        return;
+    }
+
+    if (started_)
+    {
+        const size_t r = pairs_n_ == 0 ? newest_ : (newest_ + 1) % history_;
+        double *s = s_.data() + r * size_, *y = y_.data() + r * size_;
+
+        for (size_t i = 0; i < size_; i++)
+        {
+            s[i] = parameters[i] - previous_parameters_[i];
+            y[i] = gradient[i] - previous_gradient_[i];
+        }
+
+        // pairs with non-positive curvature would break positive definiteness
+        const double sy = std::inner_product(s, s + size_, y, 0.0);
+        if (sy > 1e-10 * std::inner_product(y, y + size_, y, 0.0))
+        {
+            rho_[r] = 1.0 / sy;
+            newest_ = r;
+            pairs_n_ = std::min(pairs_n_ + 1, history_);
+        }
+        else if (pairs_n_ == history_)
+        {
+            // the slot held the oldest pair
+            pairs_n_--;
+        }
+
+        step_ = std::min(1.0, step_ * 2.0);
+    }
+
+    started_ = true;
+    previous_score_ = score;
+    previous_parameters_ = parameters;
+    previous_gradient_ = gradient;
+
+    ComputeDirection(gradient);
+    for (size_t i = 0; i < size_; i++)
+        parameters[i] += step_ * direction_[i];
+}
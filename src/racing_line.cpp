@@ -0,0 +1,41 @@
+#include "racing_line.h"
+#include "hinge_model.h"
+
+RacingLine::Hinge::Hinge(const RacingLine *line, size_t index)
+    : line_(line), index_(index)
+{
+}
+
+std::string RacingLine::Hinge::GetTooltip() const
+{
+    std::stringstream ret;
+    ret << "Hinge | position = " << line_->GetPosition(index_);
+    ret << ", speed = " << line_->speed[index_];
+    ret << ", crossposition = " << line_->crossposition[index_];
+    ret << ", version = " << line_->version;
+
+    return ret.str();
+}
+
+size_t RacingLine::GetHingeCount() const { return speed.size(); }
+
+Vector<2, false> RacingLine::GetPosition(size_t index) const
+{
+    return Vector<2, false>({{position_x[index], position_y[index]}});
+}
+
+Vector<2, false> RacingLine::GetCrosspositionVector(size_t index) const
+{
+    return Vector<2, false>(
+        {{crossposition_vector_x[index], crossposition_vector_y[index]}});
+}
+
+void RacingLine::Visualise(std::vector<Visualisation::Object> &objects) const
+{
+    for (size_t i = 0; i + 1 < GetHingeCount(); i++)
+    {
+        objects.push_back(Visualisation::Object(GetPosition(i), GetPosition(i + 1),
+                                                &hinges[i],
+                                                HingeModel::SpeedToColor(speed[i])));
+    }
+}
@@ -0,0 +1,79 @@
+#include <cstring>
+#include <fstream>
+
+#include "exceptions.h"
+#include "track_file.h"
+#include "util.h"
+
+namespace
+{
+const char MAGIC[8] = {'G', 'K', 'T', 'R', 'A', 'C', 'K', '\0'};
+
+static_assert(sizeof(TrackFile::Header) == 40, "Track file header isn't packed");
+static_assert(sizeof(TrackFile::Record) == 16, "Track file record isn't packed");
+}
+
+TrackFile::TrackFile(const std::string &path)
+    : file_(path), records_(nullptr), waypoints_n_(0)
+{
+    // the mapping is page aligned, so the records can be used in place
+    const size_t size = file_.GetSize();
+    const auto *header = static_cast<const Header *>(file_.GetData());
+    const auto *records = reinterpret_cast<const Record *>(header + 1);
+    std::string error;
+    if (size < sizeof(Header) || std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0)
+        error = "not a track file";
+    else if (header->byte_order != BYTE_ORDER_MARK)
+        error = "written with another byte order";
+    else if (header->version != VERSION || header->record_size != sizeof(Record))
+        error = "unsupported version " + std::to_string(header->version);
+    else if ((size - sizeof(Header)) / sizeof(Record) != header->waypoints_n ||
+             (size - sizeof(Header)) % sizeof(Record) != 0)
+        error = "truncated";
+    else if (util::Checksum(records, size - sizeof(Header)) != header->checksum)
+        error = "checksum mismatch";
+
+    if (!error.empty())
+        throw Exception("Couldn't read track " + path + ", " + error);
+
+    records_ = records;
+    waypoints_n_ = header->waypoints_n;
+}
+
+size_t TrackFile::GetWaypointCount() const { return waypoints_n_; }
+
+TrackWaypoint TrackFile::GetWaypoint(size_t index) const
+{
+    const Record &record = records_[index];
+    return {record.forward, record.angle, record.left, record.right};
+}
+
+bool TrackFile::IsTrackFile(const std::string &path)
+{
+    char magic[sizeof(MAGIC)];
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    return file.read(magic, sizeof(magic)) &&
+           std::memcmp(magic, MAGIC, sizeof(MAGIC)) == 0;
+}
+
+void TrackFile::Write(const std::string &path, const std::vector<TrackWaypoint> &track)
+{
+    std::vector<Record> records;
+    records.reserve(track.size());
+    for (const auto &w : track)
+        records.push_back({w.forward, w.left, w.right, w.angle});
+
+    Header header;
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.byte_order = BYTE_ORDER_MARK;
+    header.record_size = sizeof(Record);
+    header.reserved = 0;
+    header.waypoints_n = records.size();
+    header.checksum = util::Checksum(records.data(), records.size() * sizeof(Record));
+
+    util::WriteFileAtomically(
+        path, {{reinterpret_cast<const char *>(&header), sizeof(header)},
+               {reinterpret_cast<const char *>(records.data()),
+                records.size() * sizeof(Record)}});
+}
@@ -0,0 +1,227 @@
+#include <charconv>
+#include <cstring>
+
+#include "exceptions.h"
+#include "track_parser.h"
+
+namespace
+{
+bool IsBlank(char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r'; }
+
+std::string_view Trim(std::string_view s)
+{
+    while (!s.empty() && IsBlank(s.front()))
+        s.remove_prefix(1);
+    while (!s.empty() && IsBlank(s.back()))
+        s.remove_suffix(1);
+    return s;
+}
+
+const char *const FIELDS[] = {"forward", "angle", "left", "right"};
+}
+
+TrackParser::TrackParser(const std::string &path)
+    : file_(path, std::ios::in | std::ios::binary), path_(path), buffer_(CHUNK),
+      begin_(0), end_(0), in_track_(false), done_(false), pending_end_(false),
+      waypoints_n_(0)
+{
+    if (!file_.is_open())
+        throw Exception("Couldn't open track " + path);
+}
+
+void TrackParser::Fail(const std::string &message) const
+{
+    throw Exception("Couldn't parse track " + path_ + ", " + message + " after " +
+                    std::to_string(waypoints_n_) + " waypoints");
+}
+
+bool TrackParser::Find(char c, size_t from, size_t &offset)
+{
+    size_t searched = from;
+    while (true)
+    {
+        const char *start = buffer_.data() + begin_;
+        if (searched < end_ - begin_)
+        {
+            auto found = std::memchr(start + searched, c, end_ - begin_ - searched);
+            if (found)
+            {
+                offset = static_cast<const char *>(found) - start;
+                return true;
+            }
+        }
+
+        searched = end_ - begin_;
+        if (!file_)
+            return false;
+
+        // the unparsed bytes are the beginning of the token, keep them
+        std::memmove(buffer_.data(), start, end_ - begin_);
+        end_ -= begin_;
+        begin_ = 0;
+        if (end_ == buffer_.size())
+            Fail("token longer than " + std::to_string(CHUNK) + " bytes");
+
+        file_.read(buffer_.data() + end_, buffer_.size() - end_);
+        end_ += file_.gcount();
+    }
+}
+
+TrackParser::Token TrackParser::NextToken(std::string_view &value)
+{
+    if (pending_end_)
+    {
+        pending_end_ = false;
+        value = pending_name_;
+        return Token::EndTag;
+    }
+
+    while (true)
+    {
+        size_t open, close;
+        if (!Find('<', 0, open))
+            open = end_ - begin_;
+
+        if (open > 0)
+        {
+            value = std::string_view(buffer_.data() + begin_, open);
+            begin_ += open;
+            return Token::Text;
+        }
+
+        if (begin_ == end_)
+            return Token::End;
+
+        if (!Find('>', 0, close))
+            Fail("unterminated tag");
+
+        std::string_view tag(buffer_.data() + begin_ + 1, close - 1);
+        if (tag.substr(0, 3) == "!--")
+        {
+            // a comment may contain '>', it only ends at "-->"
+            while (close < 6 || buffer_[begin_ + close - 1] != '-' ||
+                   buffer_[begin_ + close - 2] != '-')
+            {
+                if (!Find('>', close + 1, close))
+                    Fail("unterminated comment");
+            }
+
+            begin_ += close + 1;
+            continue;
+        }
+
+        begin_ += close + 1;
+
+        // declarations and processing instructions don't matter
+        if (tag.empty() || tag[0] == '?' || tag[0] == '!')
+            continue;
+
+        if (tag[0] == '/')
+        {
+            value = Trim(tag.substr(1));
+            return Token::EndTag;
+        }
+
+        const bool empty = tag.back() == '/';
+        if (empty)
+            tag.remove_suffix(1);
+
+        // attributes are ignored
+        size_t name_end = 0;
+        while (name_end < tag.size() && !IsBlank(tag[name_end]))
+            name_end++;
+        value = tag.substr(0, name_end);
+
+        if (empty)
+        {
+            pending_end_ = true;
+            pending_name_ = std::string(value);
+        }
+
+        return Token::StartTag;
+    }
+}
+
+TrackParser::Token TrackParser::NextNonBlank(std::string_view &value)
+{
+    while (true)
+    {
+        Token token = NextToken(value);
+        if (token != Token::Text || !Trim(value).empty())
+            return token;
+    }
+}
+
+bool TrackParser::Next(TrackWaypoint &waypoint)
+{
+    if (done_)
+        return false;
+
+    std::string_view value;
+    if (!in_track_)
+    {
+        if (NextNonBlank(value) != Token::StartTag || value != "track")
+            Fail("no track element");
+
+        in_track_ = true;
+    }
+
+    Token token = NextNonBlank(value);
+    if (token == Token::EndTag && value == "track")
+    {
+        done_ = true;
+        return false;
+    }
+
+    if (token != Token::StartTag || value != "waypoint")
+        Fail("expected a waypoint");
+
+    // fields missing from the waypoint read as zero, unknown ones are skipped
+    float *const fields[] = {&waypoint.forward, &waypoint.angle, &waypoint.left,
+                             &waypoint.right};
+    waypoint = {0.0f, 0.0f, 0.0f, 0.0f};
+
+    while ((token = NextNonBlank(value)) != Token::EndTag)
+    {
+        if (token != Token::StartTag)
+            Fail("expected a waypoint field");
+
+        int field = -1;
+        for (int f = 0; f < 4; f++)
+        {
+            if (value == FIELDS[f])
+                field = f;
+        }
+
+        token = NextToken(value);
+        if (token == Token::Text)
+        {
+            // Parsed as a double and then narrowed, the same as pugixml's as_float,
+            // so tracks give exactly the same waypoints as with the document parser.
+            auto number = Trim(value);
+            if (!number.empty() && number[0] == '+')
+                number.remove_prefix(1);
+
+            double parsed;
+            auto result =
+                std::from_chars(number.data(), number.data() + number.size(), parsed);
+            if (field >= 0 && (result.ec != std::errc() ||
+                               result.ptr != number.data() + number.size()))
+                Fail("invalid " + std::string(FIELDS[field]));
+
+            if (field >= 0)
+                *fields[field] = float(parsed);
+
+            token = NextToken(value);
+        }
+
+        if (token != Token::EndTag || (field >= 0 && value != FIELDS[field]))
+            Fail("unterminated waypoint field");
+    }
+
+    if (value != "waypoint")
+        Fail("unterminated waypoint");
+
+    waypoints_n_++;
+    return true;
+}
@@ -1,4 +1,8 @@
 #include <boost/any.hpp>
+#include <cerrno>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
 
 #include "exceptions.h"
 #include "util.h"
@@ -99,4 +103,46 @@ adept::aReal util::CircumcircleRadius(const Vector<2, true> &p1,
     // clang-format on
 
     return adept::sqrt(bx * bx + by * by - 4.0 * a * c) / (2.0 * adept::abs(a));
-}
\ No newline at end of file
+}
+
+uint64_t util::Checksum(const void *data, size_t size, uint64_t seed)
+{
+    const auto *bytes = static_cast<const unsigned char *>(data);
+    uint64_t hash = seed;
+    for (size_t i = 0; i < size; i++)
+        hash = (hash ^ bytes[i]) * 0x100000001b3ULL;
+    return hash;
+}
+
+void util::WriteFileAtomically(const std::string &path,
+                               const std::vector<std::string_view> &pieces)
+{
+    const std::string temporary = path + ".tmp";
+    const int fd = open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        throw Exception("Couldn't create " + temporary);
+
+    bool written = true;
+    for (auto piece : pieces)
+    {
+        while (written && !piece.empty())
+        {
+            const ssize_t n = write(fd, piece.data(), piece.size());
+            if (n < 0 && errno == EINTR)
+                continue;
+
+            written = n > 0;
+            if (written)
+                piece.remove_prefix(n);
+        }
+    }
+
+    // the data has to be on the disk before the rename is
+    written = fsync(fd) == 0 && written;
+    written = close(fd) == 0 && written;
+    if (!written || std::rename(temporary.c_str(), path.c_str()) != 0)
+    {
+        std::remove(temporary.c_str());
+        throw Exception("Couldn't write " + path);
+    }
+}
@@ -0,0 +1,75 @@
+#include "worker_pool.h"
+#include "exceptions.h"
+
+WorkerPool::WorkerPool(size_t threads)
+    : tasks_n_(0), next_task_(0), tasks_done_(0), exit_(false)
+{
+    ASSERT(threads > 0, "Worker pool needs at least one thread");
+
+    for (size_t i = 0; i < threads; i++)
+        threads_.emplace_back(&WorkerPool::WorkerLoop, this);
+
+    log_.Info() << "Started " << threads << " worker threads.";
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        exit_ = true;
+    }
+    work_cv_.notify_all();
+
+    for (auto &thread : threads_)
+        thread.join();
+}
+
+size_t WorkerPool::GetSize() const { return threads_.size(); }
+
+void WorkerPool::Run(size_t tasks, std::function<void(size_t)> job)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    job_ = std::move(job);
+    tasks_n_ = tasks;
+    next_task_ = 0;
+    tasks_done_ = 0;
+    error_ = nullptr;
+
+    work_cv_.notify_all();
+    done_cv_.wait(lock, [this] { return tasks_done_ == tasks_n_; });
+
+    job_ = nullptr;
+    if (error_)
+        std::rethrow_exception(error_);
+}
+
+void WorkerPool::WorkerLoop()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    while (true)
+    {
+        work_cv_.wait(lock, [this] { return exit_ || next_task_ < tasks_n_; });
+        if (exit_)
+            return;
+
+        size_t task = next_task_++;
+        auto &job = job_;
+
+        lock.unlock();
+        try
+        {
+            job(task);
+        }
+        catch (...)
+        {
+            lock.lock();
+            error_ = std::current_exception();
+            lock.unlock();
+        }
+        lock.lock();
+
+        if (++tasks_done_ == tasks_n_)
+            done_cv_.notify_all();
+    }
+}
@@ -0,0 +1,596 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE "Analytic gradient tests"
+
+#include "config.h"
+#include "hinge_kernel.h"
+#include "hinge_model.h"
+#include <boost/test/unit_test.hpp>
+#include <cmath>
+
+void BuildArc(HingeModel &model, int hinges)
+{
+    for (int i = 0; i < hinges; i++)
+    {
+        double angle = i * 0.08;
+        auto hinge = model.AddHinge(
+            Vector<2, false>({{500.0 + 120.0 * std::cos(angle) + 3.0 * std::sin(i * 1.3),
+                               500.0 + 120.0 * std::sin(angle)}}),
+            6.0, i * 10.0);
+
+        model.SetCrossposition(hinge, 0.4 * std::sin(i * 0.7));
+        model.SetSpeed(hinge, 20.0 + 7.0 * std::cos(i * 0.9));
+    }
+}
+
+// Checks the gradients of model against a full evaluation of the same state.
+void CheckMatchesFullGradient(const HingeModel &model, int hinges, adept::Stack &stack)
+{
+    HingeModel full_model;
+    BuildArc(full_model, hinges);
+    full_model.SetState(model.GetCrosspositions().data(), model.GetSpeeds().data());
+
+    BOOST_CHECK_CLOSE(full_model.ComputeGradient(stack), model.GetScore(), 1e-9);
+    for (size_t i = 0; i < model.GetHingeCount(); i++)
+    {
+        auto a = full_model.GetHinge(i);
+        auto b = model.GetHinge(i);
+
+        BOOST_CHECK_SMALL(a.GetSpeedGradient() - b.GetSpeedGradient(), 1e-9);
+        BOOST_CHECK_SMALL(a.GetCrosspositionGradient() - b.GetCrosspositionGradient(),
+                          1e-9);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(AnalyticMatchesAdept)
+{
+    adept::Stack stack;
+
+    Config::inst().SetParameter("gradient_backend", std::string("adept"));
+    HingeModel adept_model;
+    BuildArc(adept_model, 40);
+
+    Config::inst().SetParameter("gradient_backend", std::string("analytic"));
+    HingeModel analytic_model;
+    BuildArc(analytic_model, 40);
+
+    BOOST_CHECK(adept_model.GetGradientBackend() == HingeModel::GradientBackend::Adept);
+    BOOST_CHECK(analytic_model.GetGradientBackend() ==
+                HingeModel::GradientBackend::Analytic);
+
+    double adept_score = adept_model.ComputeGradient(stack);
+    double analytic_score = analytic_model.ComputeGradient(stack);
+
+    BOOST_CHECK_CLOSE(adept_score, analytic_score, 1e-6);
+
+    BOOST_REQUIRE_EQUAL(adept_model.GetHingeCount(), analytic_model.GetHingeCount());
+    for (size_t i = 0; i < adept_model.GetHingeCount(); i++)
+    {
+        auto a = adept_model.GetHinge(i);
+        auto b = analytic_model.GetHinge(i);
+
+        BOOST_CHECK_CLOSE(a.GetSpeedGradient(), b.GetSpeedGradient(), 1e-4);
+        if (i > 0 && i + 1 < adept_model.GetHingeCount())
+            BOOST_CHECK_CLOSE(a.GetCrosspositionGradient(), b.GetCrosspositionGradient(),
+                              1e-4);
+    }
+};
+
+BOOST_AUTO_TEST_CASE(AnalyticOptimizationDecreasesScore)
+{
+    adept::Stack stack;
+
+    Config::inst().SetParameter("gradient_backend", std::string("analytic"));
+    HingeModel model;
+    BuildArc(model, 40);
+
+    double first = model.ComputeGradient(stack);
+    for (int i = 0; i < 20; i++)
+    {
+        model.Optimize(stack);
+        BOOST_CHECK(model.IsFeasible());
+    }
+
+    BOOST_CHECK_LT(model.GetScore(), first);
+};
+
+BOOST_AUTO_TEST_CASE(LineSearchConverges)
+{
+    adept::Stack stack;
+
+    Config::inst().SetParameter("gradient_backend", std::string("analytic"));
+    Config::inst().SetParameter("optimizer", std::string("lbfgs"));
+    HingeModel model;
+    BuildArc(model, 30);
+
+    double previous = model.ComputeGradient(stack);
+    bool converged = false;
+    for (int i = 0; i < 5000 && !converged; i++)
+    {
+        converged = model.Optimize(stack);
+
+        // every accepted step stays inside the barriers and doesn't increase the score
+        BOOST_REQUIRE(model.IsFeasible());
+        BOOST_REQUIRE_LE(model.GetScore(), previous);
+        previous = model.GetScore();
+    }
+
+    BOOST_REQUIRE(converged);
+
+    auto speeds = model.GetSpeeds();
+    BOOST_CHECK(model.Optimize(stack));
+    BOOST_CHECK(model.GetSpeeds() == speeds);
+
+    // changing the state starts the optimization over
+    model.SetSpeed(10, model.GetSpeeds()[10] * 0.9);
+    BOOST_CHECK(!model.Optimize(stack));
+
+    Config::inst().SetParameter("optimizer", std::string("sgd"));
+};
+
+BOOST_AUTO_TEST_CASE(HessianMatchesGradientDifferences)
+{
+    const hinge_kernel::Stencil stencil = {
+        {0.0, 0.0}, {10.0, 1.0}, {20.0, 3.5}, 25.0, 27.0};
+    const double directions[3][2] = {{-0.1, 6.0}, {-0.5, 5.9}, {-1.0, 5.8}};
+
+    // first derivatives along the directions and the speeds
+    auto gradient = [&directions](const hinge_kernel::Stencil &s, int i) {
+        auto r = hinge_kernel::Evaluate(s, 300.0, 4.9);
+        const double *d[3] = {r.d_previous, r.d_current, r.d_next};
+        if (i < 3)
+            return d[i][0] * directions[i][0] + d[i][1] * directions[i][1];
+        return i == 3 ? r.d_speed : r.d_next_speed;
+    };
+
+    auto moved = [&directions](hinge_kernel::Stencil s, int j, double h) {
+        double *p[3] = {s.previous, s.current, s.next};
+        if (j < 3)
+        {
+            p[j][0] += h * directions[j][0];
+            p[j][1] += h * directions[j][1];
+        }
+        else
+        {
+            (j == 3 ? s.speed : s.next_speed) += h;
+        }
+        return s;
+    };
+
+    double hessian[5][5];
+    hinge_kernel::Hessian(stencil, directions, 300.0, 4.9, hessian);
+
+    const double h = 1e-5;
+    for (int i = 0; i < 5; i++)
+    {
+        for (int j = 0; j < 5; j++)
+        {
+            double difference = (gradient(moved(stencil, j, h), i) -
+                                 gradient(moved(stencil, j, -h), i)) /
+                                (2.0 * h);
+            BOOST_CHECK_SMALL(hessian[i][j] - difference, 1e-7);
+        }
+    }
+};
+
+BOOST_AUTO_TEST_CASE(BoundaryPenaltyMatchesDifferences)
+{
+    adept::Stack stack;
+
+    Config::inst().SetParameter("gradient_backend", std::string("analytic"));
+    Config::inst().SetParameter("boundary_penalty", 3.0f);
+    Config::inst().SetParameter("boundary_margin", 2.0f);
+
+    // straight track, the bands are right at the crossposition limits
+    HingeModel model;
+    using Side = HingeModel::BandSegement::Side;
+    HingeModel::BandSegement *last_left = nullptr, *last_right = nullptr;
+    for (int i = 0; i < 20; i++)
+    {
+        const double x = 200.0 + 10.0 * i;
+        auto hinge = model.AddHinge(Vector<2, false>({{x, 500.0}}), 6.0, i * 10.0);
+        model.SetCrossposition(hinge, 0.93 * std::sin(i * 0.7));
+        model.SetSpeed(hinge, 20.0 + 3.0 * std::cos(i * 0.9));
+
+        auto left = model.AddBandSegment(Vector<2, false>({{x, 506.0}}), Side::Left);
+        auto right = model.AddBandSegment(Vector<2, false>({{x, 494.0}}), Side::Right);
+        if (last_left)
+        {
+            last_left->LinkForward(left);
+            last_right->LinkForward(right);
+        }
+
+        last_left = left;
+        last_right = right;
+    }
+
+    const double score = model.ComputeGradient(stack);
+    std::vector<double> gradient;
+    for (size_t i = 0; i < model.GetHingeCount(); i++)
+        gradient.push_back(model.GetHinge(i).GetCrosspositionGradient());
+
+    Config::inst().SetParameter("boundary_penalty", 0.0f);
+    HingeModel unpenalized;
+    for (size_t i = 0; i < model.GetHingeCount(); i++)
+    {
+        unpenalized.AddHinge(Vector<2, false>({{200.0 + 10.0 * i, 500.0}}), 6.0,
+                             i * 10.0);
+        unpenalized.SetCrossposition(i, model.GetCrosspositions()[i]);
+        unpenalized.SetSpeed(i, model.GetSpeeds()[i]);
+    }
+    BOOST_CHECK_GT(score, unpenalized.ComputeGradient(stack) + 1.0);
+
+    const double h = 1e-6;
+    for (size_t i = 1; i + 1 < model.GetHingeCount(); i++)
+    {
+        const double cp = model.GetCrosspositions()[i];
+        model.SetCrossposition(i, cp + h);
+        const double up = model.ComputeGradient(stack);
+        model.SetCrossposition(i, cp - h);
+        const double down = model.ComputeGradient(stack);
+        model.SetCrossposition(i, cp);
+
+        BOOST_CHECK_SMALL(gradient[i] - (up - down) / (2.0 * h), 1e-3);
+    }
+};
+
+BOOST_AUTO_TEST_CASE(NewtonConvergesFast)
+{
+    adept::Stack stack;
+
+    Config::inst().SetParameter("gradient_backend", std::string("analytic"));
+    Config::inst().SetParameter("optimizer", std::string("newton"));
+    HingeModel newton_model;
+    BuildArc(newton_model, 30);
+
+    Config::inst().SetParameter("optimizer", std::string("sgd"));
+    HingeModel sgd_model;
+    BuildArc(sgd_model, 30);
+
+    for (int i = 0; i < 20; i++)
+    {
+        newton_model.Optimize(stack);
+        sgd_model.Optimize(stack);
+        BOOST_REQUIRE(newton_model.IsFeasible());
+    }
+
+    BOOST_CHECK_LT(newton_model.GetScore(), sgd_model.GetScore());
+};
+
+BOOST_AUTO_TEST_CASE(ChunkedMatchesSerial)
+{
+    adept::Stack stack;
+
+    for (std::string backend : {"adept", "analytic"})
+    {
+        Config::inst().SetParameter("gradient_backend", backend);
+
+        Config::inst().SetParameter("optimizer_threads", 1);
+        HingeModel serial_model;
+        BuildArc(serial_model, 300);
+
+        Config::inst().SetParameter("optimizer_threads", 3);
+        HingeModel chunked_model;
+        BuildArc(chunked_model, 300);
+
+        BOOST_CHECK_CLOSE(serial_model.ComputeGradient(stack),
+                          chunked_model.ComputeGradient(stack), 1e-9);
+
+        for (size_t i = 0; i < serial_model.GetHingeCount(); i++)
+        {
+            auto a = serial_model.GetHinge(i);
+            auto b = chunked_model.GetHinge(i);
+
+            BOOST_CHECK_CLOSE(a.GetSpeedGradient(), b.GetSpeedGradient(), 1e-9);
+            BOOST_CHECK_CLOSE(a.GetCrosspositionGradient(), b.GetCrosspositionGradient(),
+                              1e-9);
+        }
+    }
+
+    Config::inst().SetParameter("optimizer_threads", 1);
+};
+
+BOOST_AUTO_TEST_CASE(IncrementalMatchesFull)
+{
+    adept::Stack stack;
+    Config::inst().SetParameter("gradient_backend", std::string("analytic"));
+
+    HingeModel full_model;
+    BuildArc(full_model, 100);
+
+    Config::inst().SetParameter("incremental_tolerance", 1e-12f);
+    HingeModel incremental_model;
+    BuildArc(incremental_model, 100);
+    Config::inst().SetParameter("incremental_tolerance", 0.0f);
+
+    for (int i = 0; i < 30; i++)
+    {
+        // a local edit between the steps
+        if (i == 10)
+        {
+            full_model.SetCrossposition(50, 0.0);
+            incremental_model.SetCrossposition(50, 0.0);
+        }
+
+        full_model.Optimize(stack);
+        incremental_model.Optimize(stack);
+        BOOST_CHECK_CLOSE(full_model.GetScore(), incremental_model.GetScore(), 1e-9);
+    }
+
+    for (size_t i = 0; i < full_model.GetHingeCount(); i++)
+    {
+        BOOST_CHECK_CLOSE(full_model.GetSpeeds()[i], incremental_model.GetSpeeds()[i],
+                          1e-9);
+        BOOST_CHECK_CLOSE(full_model.GetCrosspositions()[i] + 2.0,
+                          incremental_model.GetCrosspositions()[i] + 2.0, 1e-9);
+    }
+};
+
+BOOST_AUTO_TEST_CASE(IncrementalMatchesFullAfterFullPasses)
+{
+    adept::Stack stack;
+    Config::inst().SetParameter("gradient_backend", std::string("analytic"));
+
+    // a window evaluates incrementally, the hinge pushed past the barriers makes the
+    // next step bring the line back inside the limits with a full pass
+    HingeModel windowed_model;
+    BuildArc(windowed_model, 40);
+    windowed_model.SetWindow(10, 20);
+    windowed_model.Optimize(stack);
+
+    windowed_model.SetSpeed(15, windowed_model.GetSpeeds()[15] * 4.0);
+    windowed_model.ComputeGradient(stack);
+    BOOST_REQUIRE(!windowed_model.IsFeasible());
+
+    windowed_model.Optimize(stack);
+    BOOST_REQUIRE(windowed_model.IsFeasible());
+    CheckMatchesFullGradient(windowed_model, 40, stack);
+
+    // interpolating from a coarser chain brings it inside the limits as well
+    HingeModel coarse_model;
+    BuildArc(coarse_model, 20);
+
+    Config::inst().SetParameter("incremental_tolerance", 1e-12f);
+    HingeModel incremental_model;
+    BuildArc(incremental_model, 40);
+    Config::inst().SetParameter("incremental_tolerance", 0.0f);
+
+    incremental_model.Optimize(stack);
+    incremental_model.InterpolateFrom(coarse_model);
+    for (int i = 0; i < 5; i++)
+        incremental_model.Optimize(stack);
+    CheckMatchesFullGradient(incremental_model, 40, stack);
+};
+
+BOOST_AUTO_TEST_CASE(IncrementalFeasibilityFollowsSlowDrift)
+{
+    adept::Stack stack;
+    Config::inst().SetParameter("gradient_backend", std::string("analytic"));
+    Config::inst().SetParameter("optimizer", std::string("lbfgs"));
+
+    // With the centrifugal force barrier within reach, the optimizer speeds the hinges
+    // up towards it in steps which often stay below the tolerance.
+    Config::inst().SetParameter("max_centrifugal_force", 15.0f);
+    Config::inst().SetParameter("incremental_tolerance", 0.2f);
+    HingeModel incremental_model;
+    BuildArc(incremental_model, 40);
+    Config::inst().SetParameter("incremental_tolerance", 0.0f);
+
+    HingeModel full_model;
+    BuildArc(full_model, 40);
+
+    for (int i = 0; i < 300; i++)
+    {
+        incremental_model.Optimize(stack);
+        full_model.SetState(incremental_model.GetCrosspositions().data(),
+                            incremental_model.GetSpeeds().data());
+        full_model.ComputeGradient(stack);
+
+        BOOST_CHECK(full_model.IsFeasible());
+        BOOST_CHECK_EQUAL(incremental_model.IsFeasible(), full_model.IsFeasible());
+    }
+
+    Config::inst().SetParameter("max_centrifugal_force", 300.0f);
+    Config::inst().SetParameter("optimizer", std::string("sgd"));
+};
+
+BOOST_AUTO_TEST_CASE(BatchKernelMatchesScalar)
+{
+    // 23 stencils, so the vector path has a remainder to handle
+    const size_t n = 25;
+    std::vector<double> x(n), y(n), speed(n);
+    for (size_t i = 0; i < n; i++)
+    {
+        x[i] = 100.0 * std::cos(i * 0.1) + std::sin(i * 2.1);
+        y[i] = 100.0 * std::sin(i * 0.1);
+        speed[i] = 20.0 + 5.0 * std::cos(i * 1.7);
+    }
+
+    std::vector<std::vector<double>> scalar(10, std::vector<double>(n)),
+        avx2(10, std::vector<double>(n));
+    auto output = [](std::vector<std::vector<double>> &v) {
+        return hinge_kernel::BatchOutput{
+            v[0].data(), v[1].data(), {v[2].data(), v[3].data()},
+            {v[4].data(), v[5].data()}, {v[6].data(), v[7].data()},
+            v[8].data(), v[9].data()};
+    };
+
+    hinge_kernel::EvaluateBatchScalar(x.data(), y.data(), speed.data(), 1, n - 1, 1000.0,
+                                      50.0, output(scalar));
+
+    for (size_t i = 1; i + 1 < n; i++)
+    {
+        auto result = hinge_kernel::Evaluate({{x[i - 1], y[i - 1]},
+                                              {x[i], y[i]},
+                                              {x[i + 1], y[i + 1]},
+                                              speed[i],
+                                              speed[i + 1]},
+                                             1000.0, 50.0);
+        BOOST_CHECK_EQUAL(result.score, scalar[0][i - 1]);
+        BOOST_CHECK_EQUAL(result.d_current[1], scalar[5][i - 1]);
+    }
+
+    if (!hinge_kernel::Avx2Supported())
+        return;
+
+    hinge_kernel::EvaluateBatchAvx2(x.data(), y.data(), speed.data(), 1, n - 1, 1000.0,
+                                    50.0, output(avx2));
+
+    for (size_t a = 0; a < scalar.size(); a++)
+    {
+        for (size_t k = 0; k + 2 < n; k++)
+            BOOST_CHECK_CLOSE(scalar[a][k], avx2[a][k], 1e-12);
+    }
+};
+
+template <typename Real>
+hinge_kernel::BasicBatchOutput<Real> BatchOutputOf(std::vector<std::vector<Real>> &v)
+{
+    return {v[0].data(), v[1].data(), {v[2].data(), v[3].data()},
+            {v[4].data(), v[5].data()}, {v[6].data(), v[7].data()},
+            v[8].data(), v[9].data()};
+}
+
+BOOST_AUTO_TEST_CASE(FloatKernelMatchesDouble)
+{
+    // 19 stencils, a vector of eight floats and a remainder
+    const size_t n = 21;
+    std::vector<double> x(n), y(n), speed(n);
+    std::vector<float> narrow_x(n), narrow_y(n), narrow_speed(n);
+    for (size_t i = 0; i < n; i++)
+    {
+        x[i] = 100.0 * std::cos(i * 0.1) + std::sin(i * 2.1);
+        y[i] = 100.0 * std::sin(i * 0.1);
+        speed[i] = 20.0 + 5.0 * std::cos(i * 1.7);
+        narrow_x[i] = float(x[i]);
+        narrow_y[i] = float(y[i]);
+        narrow_speed[i] = float(speed[i]);
+    }
+
+    std::vector<std::vector<double>> wide(10, std::vector<double>(n));
+    std::vector<std::vector<float>> scalar(10, std::vector<float>(n)),
+        avx2(10, std::vector<float>(n));
+
+    hinge_kernel::EvaluateBatchScalar(x.data(), y.data(), speed.data(), 1, n - 1, 1000.0,
+                                      50.0, BatchOutputOf(wide));
+    hinge_kernel::EvaluateBatchScalar(narrow_x.data(), narrow_y.data(),
+                                      narrow_speed.data(), 1, n - 1, 1000.0, 50.0,
+                                      BatchOutputOf(scalar));
+
+    for (size_t k = 0; k + 2 < n; k++)
+    {
+        BOOST_CHECK_CLOSE(wide[0][k], scalar[0][k], 1e-2);
+        BOOST_CHECK_CLOSE(wide[8][k], scalar[8][k], 1e-2);
+    }
+
+    if (!hinge_kernel::Avx2Supported())
+        return;
+
+    hinge_kernel::EvaluateBatchAvx2(narrow_x.data(), narrow_y.data(), narrow_speed.data(),
+                                    1, n - 1, 1000.0, 50.0, BatchOutputOf(avx2));
+
+    for (size_t a = 0; a < scalar.size(); a++)
+    {
+        for (size_t k = 0; k + 2 < n; k++)
+            BOOST_CHECK_EQUAL(scalar[a][k], avx2[a][k]);
+    }
+};
+
+BOOST_AUTO_TEST_CASE(FloatPrecisionPolishesInDouble)
+{
+    adept::Stack stack;
+
+    Config::inst().SetParameter("gradient_backend", std::string("analytic"));
+    Config::inst().SetParameter("optimizer", std::string("lbfgs"));
+    Config::inst().SetParameter("precision", std::string("double"));
+    HingeModel double_model;
+    BuildArc(double_model, 30);
+
+    Config::inst().SetParameter("precision", std::string("float"));
+    HingeModel float_model;
+    BuildArc(float_model, 30);
+    BOOST_CHECK(float_model.GetPrecision() == HingeModel::Precision::Float);
+
+    BOOST_CHECK_CLOSE(double_model.ComputeGradient(stack),
+                      float_model.ComputeGradient(stack), 1e-3);
+
+    for (int i = 0; i < 5000 && !float_model.Optimize(stack); i++)
+        BOOST_REQUIRE(float_model.IsFeasible());
+
+    // the final steps were taken in double precision
+    BOOST_CHECK(float_model.GetPrecision() == HingeModel::Precision::Double);
+    BOOST_CHECK(float_model.Optimize(stack));
+
+    Config::inst().SetParameter("precision", std::string("double"));
+    Config::inst().SetParameter("optimizer", std::string("sgd"));
+};
+
+BOOST_AUTO_TEST_CASE(WindowKeepsOtherHingesFixed)
+{
+    adept::Stack stack;
+
+    Config::inst().SetParameter("gradient_backend", std::string("analytic"));
+    Config::inst().SetParameter("optimizer", std::string("lbfgs"));
+    HingeModel model;
+    BuildArc(model, 40);
+
+    const auto crosspositions = model.GetCrosspositions();
+    const auto speeds = model.GetSpeeds();
+    const double first = model.ComputeGradient(stack);
+
+    model.SetWindow(10, 20);
+    bool converged = false;
+    for (int i = 0; i < 2000 && !converged; i++)
+        converged = model.Optimize(stack);
+
+    BOOST_CHECK(converged);
+    BOOST_CHECK_LT(model.GetScore(), first);
+    for (size_t i = 0; i < model.GetHingeCount(); i++)
+    {
+        if (i >= 10 && i < 20)
+            continue;
+
+        BOOST_CHECK_EQUAL(model.GetCrosspositions()[i], crosspositions[i]);
+        BOOST_CHECK_EQUAL(model.GetSpeeds()[i], speeds[i]);
+    }
+
+    // the incrementally updated score matches a full evaluation of the same state
+    const double windowed = model.GetScore();
+    model.SetWindow(0, SIZE_MAX);
+    model.SetSpeed(0, model.GetSpeeds()[0]);
+    BOOST_CHECK_CLOSE(model.ComputeGradient(stack), windowed, 1e-9);
+
+    // sliding the window starts the optimization over
+    model.SetWindow(20, 30);
+    BOOST_CHECK(!model.Optimize(stack));
+
+    Config::inst().SetParameter("optimizer", std::string("sgd"));
+};
+
+BOOST_AUTO_TEST_CASE(WindowWrapsAroundTheLap)
+{
+    adept::Stack stack;
+
+    Config::inst().SetParameter("gradient_backend", std::string("analytic"));
+    Config::inst().SetParameter("optimizer", std::string("lbfgs"));
+    HingeModel model;
+    BuildArc(model, 40);
+
+    const auto crosspositions = model.GetCrosspositions();
+    const auto speeds = model.GetSpeeds();
+
+    // the last five hinges and the first five of the next lap
+    model.SetWindow(35, 45);
+    for (int i = 0; i < 50; i++)
+        model.Optimize(stack);
+
+    // the ends are pinned to the track centre, and no stencil depends on the speed of
+    // the first hinge
+    for (size_t i = 1; i + 1 < model.GetHingeCount(); i++)
+    {
+        const bool free = i < 5 || i >= 35;
+        BOOST_CHECK_EQUAL(model.GetSpeeds()[i] != speeds[i], free);
+        BOOST_CHECK_EQUAL(model.GetCrosspositions()[i] != crosspositions[i], free);
+    }
+
+    Config::inst().SetParameter("optimizer", std::string("sgd"));
+};
@@ -0,0 +1,78 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE "Arena tests"
+
+#include "arena.h"
+#include <boost/test/unit_test.hpp>
+#include <vector>
+
+std::vector<int> constructed, destroyed;
+
+struct Tracked
+{
+    int id;
+    double payload[3];
+
+    explicit Tracked(int id) : id(id), payload{id * 1.0, id * 2.0, id * 3.0}
+    {
+        constructed.push_back(id);
+    }
+    ~Tracked() { destroyed.push_back(id); }
+};
+
+BOOST_AUTO_TEST_CASE(ConstructsInOrderAndKeepsAddresses)
+{
+    constructed.clear();
+    destroyed.clear();
+
+    std::vector<int> expected;
+    {
+        Arena<Tracked, 4> arena;
+        std::vector<Tracked *> objects;
+        for (int i = 0; i < 3; i++)
+        {
+            objects.push_back(arena.Create(i));
+            expected.push_back(i);
+        }
+
+        // the first block is contiguous
+        BOOST_CHECK_EQUAL(objects[1], objects[0] + 1);
+        BOOST_CHECK_EQUAL(objects[2], objects[0] + 2);
+
+        // several more blocks are added, the objects created before stay where they are
+        for (int i = 3; i < 19; i++)
+        {
+            objects.push_back(arena.Create(i));
+            expected.push_back(i);
+        }
+
+        BOOST_CHECK(constructed == expected);
+        BOOST_CHECK(destroyed.empty());
+        BOOST_CHECK_EQUAL(arena.GetSize(), 19);
+        for (int i = 0; i < 19; i++)
+        {
+            BOOST_CHECK_EQUAL(objects[i]->id, i);
+            BOOST_CHECK_EQUAL(objects[i]->payload[2], i * 3.0);
+        }
+    }
+
+    // everything is destroyed with the arena, the newest object first
+    BOOST_CHECK(destroyed == std::vector<int>(expected.rbegin(), expected.rend()));
+};
+
+BOOST_AUTO_TEST_CASE(ClearDestroysAndAllowsReuse)
+{
+    destroyed.clear();
+
+    Arena<Tracked, 4> arena;
+    for (int i = 0; i < 6; i++)
+        arena.Create(i);
+
+    arena.Clear();
+    BOOST_CHECK_EQUAL(arena.GetSize(), 0);
+    BOOST_CHECK(destroyed == std::vector<int>({5, 4, 3, 2, 1, 0}));
+
+    destroyed.clear();
+    BOOST_CHECK_EQUAL(arena.Create(7)->id, 7);
+    BOOST_CHECK_EQUAL(arena.GetSize(), 1);
+    BOOST_CHECK(destroyed.empty());
+};
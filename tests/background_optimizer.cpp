@@ -0,0 +1,73 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE "Background optimizer tests"
+
+#include "background_optimizer.h"
+#include "config.h"
+#include <boost/test/unit_test.hpp>
+#include <chrono>
+#include <cmath>
+
+BOOST_AUTO_TEST_CASE(TripleBufferKeepsLatest)
+{
+    TripleBuffer<int> buffer;
+
+    buffer.GetBack() = 1;
+    buffer.Publish();
+    BOOST_CHECK_EQUAL(buffer.Read(), 1);
+
+    // nothing new, the reader keeps its value
+    BOOST_CHECK_EQUAL(buffer.Read(), 1);
+
+    buffer.GetBack() = 2;
+    buffer.Publish();
+    buffer.GetBack() = 3;
+    buffer.Publish();
+
+    const int &latest = buffer.Read();
+    BOOST_CHECK_EQUAL(latest, 3);
+
+    // the writer never touches the value the reader holds
+    buffer.GetBack() = 4;
+    buffer.Publish();
+    buffer.GetBack() = 5;
+    BOOST_CHECK_EQUAL(latest, 3);
+};
+
+BOOST_AUTO_TEST_CASE(PublishesImprovingLines)
+{
+    Config::inst().SetParameter("gradient_backend", std::string("analytic"));
+    Config::inst().SetParameter("optimizations_per_frame", 5);
+
+    HingeModel model;
+    for (int i = 0; i < 60; i++)
+    {
+        double angle = i * 0.08;
+        model.AddHinge(Vector<2, false>({{500.0 + 120.0 * std::cos(angle),
+                                          500.0 + 120.0 * std::sin(angle)}}),
+                       6.0, i * 10.0);
+    }
+
+    BackgroundOptimizer optimizer(model, 1e9);
+
+    const auto &first = optimizer.GetRacingLine();
+    BOOST_CHECK_EQUAL(first.version, 1);
+    BOOST_CHECK_EQUAL(first.GetHingeCount(), 60);
+    BOOST_CHECK_EQUAL(first.speed[10], 10.0);
+
+    optimizer.SetPaused(false);
+
+    const RacingLine *line = &first;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (line->version < 20 && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::yield();
+        line = &optimizer.GetRacingLine();
+    }
+
+    optimizer.SetPaused(true);
+
+    BOOST_CHECK_GE(line->version, 20);
+    BOOST_CHECK_LT(line->score, 1e9);
+    BOOST_CHECK_EQUAL(line->hinges.size(), 60);
+    BOOST_CHECK_NE(line->speed[10], 10.0);
+};
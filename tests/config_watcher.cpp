@@ -0,0 +1,61 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE "Config watcher tests"
+
+#include "config_watcher.h"
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+#include <chrono>
+#include <fstream>
+#include <thread>
+
+void WriteConfig(const std::string &path, const std::string &options)
+{
+    std::ofstream(path) << "<?xml version=\"1.0\"?>\n<configuration>\n"
+                        << options << "</configuration>\n";
+}
+
+// waits for a snapshot newer than the given version
+const ConfigSnapshot &WaitForReload(ConfigWatcher &watcher, uint64_t version)
+{
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (watcher.Read().version == version &&
+           std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+
+    return watcher.Read();
+}
+
+BOOST_AUTO_TEST_CASE(PublishesChangedFiles)
+{
+    auto path = (boost::filesystem::temp_directory_path() /
+                 boost::filesystem::unique_path("settings-%%%%%%%%.xml"))
+                    .string();
+    WriteConfig(path, "<forward_boost>20</forward_boost>\n");
+    Config::inst().SetParameter("config_poll_interval", 10);
+    Config::inst().SetParameter("cross_safety_margin", 0.5f);
+
+    ConfigWatcher watcher(path);
+    BOOST_CHECK_EQUAL(watcher.Read().version, 0);
+
+    // the options loaded before the watcher stay unless the file overrides them
+    WriteConfig(path, "<forward_boost>35.5</forward_boost>\n");
+    const auto &reloaded = WaitForReload(watcher, 0);
+    BOOST_REQUIRE_EQUAL(reloaded.version, 1);
+    BOOST_CHECK_EQUAL(reloaded.GetOption<float>("forward_boost"), 35.5f);
+    BOOST_CHECK_EQUAL(reloaded.GetOption<float>("cross_safety_margin"), 0.5f);
+
+    // a broken file keeps the last snapshot, the next good one is published
+    WriteConfig(path, "<forward_boost>40</forward_boost><unknown>1</unknown>\n");
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    BOOST_CHECK_EQUAL(watcher.Read().version, 1);
+
+    WriteConfig(path, "<cross_safety_margin>0.75</cross_safety_margin>\n");
+    const auto &fixed = WaitForReload(watcher, 1);
+    BOOST_REQUIRE_EQUAL(fixed.version, 2);
+    BOOST_CHECK_EQUAL(fixed.GetOption<float>("cross_safety_margin"), 0.75f);
+    BOOST_CHECK_EQUAL(fixed.GetOption<float>("forward_boost"), 20.0f);
+
+    // the global options aren't touched from the watcher's thread
+    BOOST_CHECK_EQUAL(Config::inst().GetOption<float>("cross_safety_margin"), 0.5f);
+    boost::filesystem::remove(path);
+};
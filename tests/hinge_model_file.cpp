@@ -0,0 +1,65 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE "Hinge model file tests"
+
+#include "config.h"
+#include "data_reader.h"
+#include "exceptions.h"
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+#include <fstream>
+
+BOOST_AUTO_TEST_CASE(HingeModelFileRoundTrip)
+{
+    Track track;
+    for (int i = 0; i < 2000; i++)
+        track.push_back({1.0f, i < 1000 ? 1.0f : -0.5f, 6.0f, 6.0f});
+
+    auto build = [&](HingeModel &model) {
+        DataReader::BuildHingeModel(track, model, Vector<2, false>({{500.0, 500.0}}));
+    };
+
+    HingeModel saved;
+    build(saved);
+    BOOST_REQUIRE_GT(saved.GetHingeCount(), 10);
+    for (size_t i = 0; i < saved.GetHingeCount(); i++)
+    {
+        saved.SetCrossposition(i, 0.25 * (i % 3));
+        saved.SetSpeed(i, 20.0 + i);
+    }
+
+    auto path = (boost::filesystem::temp_directory_path() /
+                 boost::filesystem::unique_path("model-%%%%%%%%.hinges"))
+                    .string();
+    DataReader::SaveHingeModel(path, saved);
+    BOOST_CHECK(!boost::filesystem::exists(path + ".tmp"));
+
+    HingeModel loaded;
+    build(loaded);
+    DataReader::ReadHingeModel(path, loaded);
+    BOOST_CHECK(loaded.GetCrosspositions() == saved.GetCrosspositions());
+    BOOST_CHECK(loaded.GetSpeeds() == saved.GetSpeeds());
+
+    // built with another hinge separation, the hinges don't match
+    const float band_separation = Config::inst().GetOption<float>("band_separation");
+    Config::inst().SetParameter("band_separation", band_separation * 2.0f);
+    HingeModel other;
+    build(other);
+    BOOST_CHECK_THROW(DataReader::ReadHingeModel(path, other), Exception);
+    Config::inst().SetParameter("band_separation", band_separation);
+
+    // the same number of hinges along another track
+    track[1500].angle = 2.0f;
+    HingeModel bent;
+    build(bent);
+    BOOST_REQUIRE_EQUAL(bent.GetHingeCount(), saved.GetHingeCount());
+    BOOST_CHECK_THROW(DataReader::ReadHingeModel(path, bent), Exception);
+
+    {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(-1, std::ios::end);
+        file.put(0x7f);
+    }
+    BOOST_CHECK_THROW(DataReader::ReadHingeModel(path, loaded), Exception);
+
+    boost::filesystem::remove(path);
+};
@@ -0,0 +1,95 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE "Model element tests"
+
+#include "config.h"
+#include "hinge_model.h"
+#include "track_fixtures.h"
+#include <boost/test/unit_test.hpp>
+#include <string>
+#include <vector>
+
+// passes in the order they reached the elements
+std::vector<std::string> calls;
+
+template <char Kind> class Recorder : public ModelElement
+{
+    template <typename... Ts> friend class ElementPasses;
+
+    int id_;
+
+    void Record(const std::string &pass) const
+    {
+        calls.push_back(pass + " " + Kind + std::to_string(id_));
+    }
+
+    void SetupEquationsThis() override { Record("setup"); }
+    void ComputeScoreThis(adept::aReal &score) const override { Record("score"); }
+    void ApplyGradientThis(double) override { Record("apply"); }
+    void VisualiseThis(std::vector<Visualisation::Object> &objects) const override
+    {
+        Record("visualise");
+    }
+
+  public:
+    explicit Recorder(int id) : id_(id) {}
+};
+
+using Scored = Recorder<'a'>;
+using Drawn = Recorder<'b'>;
+
+template <> struct PassTraits<Drawn>
+{
+    static constexpr bool setup = false;
+    static constexpr bool score = false;
+    static constexpr bool apply = false;
+    static constexpr bool visualise = true;
+};
+
+BOOST_AUTO_TEST_CASE(PassesRunTypeByType)
+{
+    adept::Stack stack;
+
+    Scored a0(0), a1(1), a2(2);
+    Drawn b0(0), b1(1);
+
+    ElementPasses<Scored, Drawn> passes;
+    passes.Add(&a0);
+    passes.Add(&b0);
+    passes.Add(&a1);
+    passes.Add(&b1);
+    passes.Add(&a2);
+
+    using Calls = std::vector<std::string>;
+
+    passes.SetupEquations();
+    BOOST_CHECK(calls == Calls({"setup a0", "setup a1", "setup a2"}));
+
+    calls.clear();
+    adept::aReal score = 0.0;
+    passes.ComputeScore(score);
+    BOOST_CHECK(calls == Calls({"score a0", "score a1", "score a2"}));
+
+    calls.clear();
+    passes.ApplyGradient(1.0);
+    BOOST_CHECK(calls == Calls({"apply a0", "apply a1", "apply a2"}));
+
+    calls.clear();
+    std::vector<Visualisation::Object> objects;
+    passes.Visualise(objects);
+    BOOST_CHECK(calls == Calls({"visualise a0", "visualise a1", "visualise a2",
+                                "visualise b0", "visualise b1"}));
+};
+
+BOOST_AUTO_TEST_CASE(PassesThroughBaseReachElements)
+{
+    HingeModel model;
+    DataReader::BuildHingeModel(ReadArc(), model, Vector<2, false>({{500.0, 500.0}}));
+
+    // the band segments are drawn by the element passes only
+    std::vector<Visualisation::Object> direct, through_base;
+    model.Visualise(direct);
+    static_cast<ModelElement &>(model).Visualise(through_base);
+
+    BOOST_CHECK_GT(direct.size(), model.GetHingeCount());
+    BOOST_CHECK_EQUAL(through_base.size(), direct.size());
+};
@@ -0,0 +1,43 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE "Multiresolution tests"
+
+#include "config.h"
+#include "multiresolution.h"
+#include "track_fixtures.h"
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_CASE(WarmStartBeatsColdStart)
+{
+    adept::Stack stack;
+    Config::inst().SetParameter("gradient_backend", std::string("analytic"));
+    Config::inst().SetParameter("multires_levels", 3);
+    Config::inst().SetParameter("multires_factor", 2.0f);
+    Config::inst().SetParameter("multires_iterations", 200);
+
+    const Track track = ReadArc();
+    const Vector<2, false> start = {{500.0, 500.0}};
+
+    HingeModel warm_model, cold_model;
+    DataReader::BuildHingeModel(track, warm_model, start);
+    DataReader::BuildHingeModel(track, cold_model, start);
+    const size_t hinges_n = cold_model.GetHingeCount();
+    BOOST_REQUIRE_GT(hinges_n, 20);
+
+    Multiresolution::WarmStart(track, start, warm_model, stack);
+    BOOST_CHECK_EQUAL(warm_model.GetHingeCount(), hinges_n);
+
+    warm_model.ComputeGradient(stack);
+    BOOST_CHECK(warm_model.IsFeasible());
+
+    for (int i = 0; i < 200; i++)
+    {
+        warm_model.Optimize(stack);
+        cold_model.Optimize(stack);
+    }
+
+    BOOST_CHECK(warm_model.IsFeasible());
+    BOOST_CHECK(cold_model.IsFeasible());
+    BOOST_CHECK_LE(warm_model.GetScore(), cold_model.GetScore());
+
+    Config::inst().SetParameter("multires_levels", 1);
+};
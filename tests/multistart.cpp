@@ -0,0 +1,82 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE "Multi-start tests"
+
+#include "config.h"
+#include "exceptions.h"
+#include "multistart.h"
+#include "track_fixtures.h"
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_CASE(SelectsBestFeasibleCandidate)
+{
+    adept::Stack stack;
+    Config::inst().SetParameter("gradient_backend", std::string("analytic"));
+
+    const Track track = ReadArc();
+    const Vector<2, false> start = {{500.0, 500.0}};
+
+    std::vector<std::unique_ptr<HingeModel>> candidates;
+    for (int k = 0; k < 3; k++)
+    {
+        candidates.push_back(std::make_unique<HingeModel>());
+        DataReader::BuildHingeModel(track, *candidates.back(), start);
+    }
+    BOOST_REQUIRE_GT(candidates[0]->GetHingeCount(), 10);
+
+    // the second candidate improves on the first one, the third one is faster than
+    // both but outside the limits, which makes its score the lowest
+    for (int i = 0; i < 50; i++)
+        candidates[1]->Optimize(stack);
+    BOOST_REQUIRE(candidates[1]->IsFeasible());
+    for (size_t i = 0; i < candidates[2]->GetHingeCount(); i++)
+        candidates[2]->SetSpeed(i, i % 2 ? 100.0 : 10.0);
+
+    double scores[3];
+    for (int k = 0; k < 3; k++)
+        scores[k] = candidates[k]->ComputeGradient(stack);
+    BOOST_REQUIRE(candidates[0]->IsFeasible());
+    BOOST_REQUIRE(!candidates[2]->IsFeasible());
+    BOOST_REQUIRE_LT(scores[1], scores[0]);
+    BOOST_REQUIRE_LT(scores[2], scores[1]);
+
+    HingeModel model;
+    DataReader::BuildHingeModel(track, model, start);
+    BOOST_CHECK_EQUAL(MultiStart::SelectBest(candidates, model, stack), 1);
+
+    BOOST_CHECK(model.GetCrosspositions() == candidates[1]->GetCrosspositions());
+    BOOST_CHECK(model.GetSpeeds() == candidates[1]->GetSpeeds());
+    BOOST_CHECK_EQUAL(model.ComputeGradient(stack), scores[1]);
+
+    // none of the candidates is inside the limits
+    candidates.erase(candidates.begin(), candidates.begin() + 2);
+    BOOST_CHECK_THROW(MultiStart::SelectBest(candidates, model, stack),
+                      AssertionFailedException);
+};
+
+BOOST_AUTO_TEST_CASE(CandidateKeepsItsAlphaAfterReset)
+{
+    adept::Stack stack;
+    Config::inst().SetParameter("gradient_backend", std::string("analytic"));
+
+    const Track track = ReadArc();
+    const Vector<2, false> start = {{500.0, 500.0}};
+
+    // the candidate is given the alpha the reference model is configured with, the
+    // configuration holds another one by the time their optimizers are reset
+    Config::inst().SetParameter("alpha", 0.002f);
+    HingeModel reference;
+    auto hyperparameters = HingeModel::Hyperparameters::FromConfig();
+    Config::inst().SetParameter("alpha", 0.0065f);
+
+    HingeModel candidate(hyperparameters), configured;
+    for (HingeModel *model : {&reference, &candidate, &configured})
+    {
+        DataReader::BuildHingeModel(track, *model, start);
+        model->ResetOptimizer();
+        model->Optimize(stack);
+    }
+
+    BOOST_CHECK(candidate.GetSpeeds() == reference.GetSpeeds());
+    BOOST_CHECK(candidate.GetCrosspositions() == reference.GetCrosspositions());
+    BOOST_CHECK(candidate.GetSpeeds() != configured.GetSpeeds());
+};
@@ -0,0 +1,115 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE "Optimizer tests"
+
+#include "block_tridiagonal.h"
+#include "config.h"
+#include "optimizer.h"
+#include <boost/test/unit_test.hpp>
+#include <cmath>
+
+// badly conditioned quadratic with its minimum at x_i = i
+double Quadratic(const std::vector<double> &x, std::vector<double> &gradient)
+{
+    double score = 0.0;
+    for (size_t i = 0; i < x.size(); i++)
+    {
+        double c = 1.0 + 9.0 * i / x.size();
+        score += c * (x[i] - i) * (x[i] - i);
+        gradient[i] = 2.0 * c * (x[i] - i);
+    }
+
+    return score;
+}
+
+BOOST_AUTO_TEST_CASE(OptimizersDecreaseScore)
+{
+    Config::inst().SetParameter("alpha", 0.02f);
+
+    for (std::string name : {"sgd", "momentum", "adam", "lbfgs"})
+    {
+        Config::inst().SetParameter("optimizer", name);
+        auto optimizer = Optimizer::Create(10);
+        BOOST_REQUIRE_EQUAL(optimizer->GetSize(), 10);
+
+        std::vector<double> x(10, 0.0), gradient(10);
+        double first = Quadratic(x, gradient);
+        double last = first;
+
+        for (int i = 0; i < 1000; i++)
+        {
+            optimizer->Step(last, gradient, x);
+            last = Quadratic(x, gradient);
+        }
+
+        BOOST_TEST_MESSAGE(name << ": " << first << " -> " << last);
+        BOOST_CHECK_LT(last, first * 1e-2);
+    }
+};
+
+BOOST_AUTO_TEST_CASE(LbfgsConvergesOnQuadratic)
+{
+    Config::inst().SetParameter("optimizer", std::string("lbfgs"));
+    auto optimizer = Optimizer::Create(10);
+
+    std::vector<double> x(10, 0.0), gradient(10);
+    double score = Quadratic(x, gradient);
+    for (int i = 0; i < 50; i++)
+    {
+        optimizer->Step(score, gradient, x);
+        score = Quadratic(x, gradient);
+    }
+
+    BOOST_CHECK_SMALL(score, 1e-12);
+};
+
+BOOST_AUTO_TEST_CASE(UnknownOptimizerThrows)
+{
+    Config::inst().SetParameter("optimizer", std::string("unknown"));
+    BOOST_CHECK_THROW(Optimizer::Create(10), Exception);
+};
+
+BOOST_AUTO_TEST_CASE(BlockTridiagonalSolves)
+{
+    // Sum of 6 x 6 windows starting at even rows, like the stencils of a hinge chain.
+    // The size is odd, so the last block is padded.
+    const size_t n = 23;
+    std::vector<std::vector<double>> dense(n, std::vector<double>(n, 0.0));
+    BlockTridiagonal matrix;
+    matrix.Reset(n);
+    BOOST_REQUIRE_EQUAL(matrix.GetSize(), 24);
+
+    for (size_t w = 0; w + 6 <= n; w += 2)
+    {
+        for (size_t i = w; i < w + 6; i++)
+        {
+            for (size_t j = i; j < w + 6; j++)
+            {
+                double v = i == j ? 2.0 + std::sin(i) : 0.2 * std::cos(i * 7.0 + j + w);
+                dense[i][j] += v;
+                if (i != j)
+                    dense[j][i] += v;
+                matrix.Add(i, j, v);
+            }
+        }
+    }
+    matrix.Add(n, n, 1.0);
+
+    std::vector<double> shift(matrix.GetSize(), 0.5), rhs(matrix.GetSize(), 0.0), x;
+    for (size_t i = 0; i < n; i++)
+        rhs[i] = std::cos(i * 0.3);
+
+    BOOST_REQUIRE(matrix.Factorize(shift));
+    matrix.Solve(rhs, x);
+
+    for (size_t i = 0; i < n; i++)
+    {
+        double row = shift[i] * x[i];
+        for (size_t j = 0; j < n; j++)
+            row += dense[i][j] * x[j];
+        BOOST_CHECK_CLOSE(row, rhs[i], 1e-9);
+    }
+
+    // indefinite without the shift
+    std::vector<double> negative(matrix.GetSize(), -10.0);
+    BOOST_CHECK(!matrix.Factorize(negative));
+};
@@ -1,9 +1,12 @@
 #define BOOST_TEST_DYN_LINK
 #define BOOST_TEST_MODULE "Segment collision tests"
 
+#include "collision_grid.h"
+#include "distance_field.h"
 #include "hinge_model.h"
 #include <algorithm>
 #include <boost/test/unit_test.hpp>
+#include <random>
 
 class TestSegment : public HingeModel::Segment
 {
@@ -47,6 +50,84 @@ BOOST_AUTO_TEST_CASE(IntersectionFunction)
                                   {{150.0f, 250.0f}}, {{250.0f, 350.0f}}));
 };
 
+BOOST_AUTO_TEST_CASE(GridMatchesIntersectionFunction)
+{
+    CollisionGrid grid;
+    std::mt19937 generator(0);
+    std::uniform_real_distribution<double> coordinate(-5.0, 45.0), offset(-8.0, 8.0);
+
+    auto random_line = [&]() {
+        double x = coordinate(generator), y = coordinate(generator);
+        return CollisionGrid::Line{x, y, x + offset(generator), y + offset(generator)};
+    };
+
+    std::vector<CollisionGrid::Line> segments;
+    for (int i = 0; i < 200; i++)
+        segments.push_back(random_line());
+    grid.Build(segments);
+    BOOST_CHECK_EQUAL(grid.GetSegmentCount(), segments.size());
+    BOOST_CHECK(grid.GetCellCount() > 1);
+
+    // the same segments far off in negative coordinates
+    auto shifted = [](CollisionGrid::Line l) {
+        return CollisionGrid::Line{l.x0 - 1e6, l.y0 - 3e6, l.x1 - 1e6, l.y1 - 3e6};
+    };
+    CollisionGrid shifted_grid;
+    std::vector<CollisionGrid::Line> shifted_segments;
+    for (const auto &s : segments)
+        shifted_segments.push_back(shifted(s));
+    shifted_grid.Build(shifted_segments);
+
+    int hits = 0;
+    for (int i = 0; i < 500; i++)
+    {
+        auto line = random_line();
+        bool expected = false;
+        for (const auto &s : segments)
+        {
+            expected |= IntersectionTest({{s.x0, s.y0}}, {{s.x1, s.y1}},
+                                         {{line.x0, line.y0}}, {{line.x1, line.y1}});
+        }
+
+        BOOST_CHECK_EQUAL(grid.Intersects(line), expected);
+        BOOST_CHECK_EQUAL(shifted_grid.Intersects(shifted(line)), expected);
+        hits += expected;
+    }
+
+    BOOST_CHECK(hits > 0);
+};
+
+BOOST_AUTO_TEST_CASE(DistanceFieldOfStraightTrack)
+{
+    // track between y = 94 and y = 106, bounds with the track on their left
+    DistanceField field(0.5, 10.0);
+    std::vector<CollisionGrid::Line> bounds;
+    for (double x = 20.0; x < 180.0; x += 10.0)
+    {
+        bounds.push_back({x + 10.0, 106.0, x, 106.0});
+        bounds.push_back({x, 94.0, x + 10.0, 94.0});
+    }
+    field.Build(bounds);
+    BOOST_CHECK(field.GetTileCount() > 0);
+
+    auto centre = field.Evaluate(100.0, 100.0);
+    BOOST_CHECK_CLOSE(centre.distance, 6.0, 1e-4);
+
+    auto left = field.Evaluate(101.3, 105.2);
+    BOOST_CHECK_CLOSE(left.distance, 0.8, 1e-3);
+    BOOST_CHECK_SMALL(left.gradient_x, 1e-6);
+    BOOST_CHECK_CLOSE(left.gradient_y, -1.0, 1e-3);
+
+    auto outside = field.Evaluate(77.7, 91.5);
+    BOOST_CHECK_CLOSE(outside.distance, -2.5, 1e-3);
+    BOOST_CHECK_CLOSE(outside.gradient_y, 1.0, 1e-3);
+
+    // past the range and where no tiles are kept
+    BOOST_CHECK_EQUAL(field.Evaluate(100.0, 150.0).distance, -10.0);
+    BOOST_CHECK_EQUAL(field.Evaluate(100.0, 180.0).distance, -10.0);
+    BOOST_CHECK_EQUAL(field.Evaluate(-5.0, 100.0).distance, -10.0);
+};
+
 BOOST_AUTO_TEST_CASE(CircumcircleRadius)
 {
     adept::Stack stack;
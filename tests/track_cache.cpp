@@ -0,0 +1,83 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE "Track cache tests"
+
+#include "config.h"
+#include "data_reader.h"
+#include "track_fixtures.h"
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_CASE(CachedTrackGeometry)
+{
+    std::string contents = "<track>\n";
+    for (int i = 0; i < 2000; i++)
+    {
+        contents += "<waypoint><forward>1.0</forward><left>6</left><right>5</right>" +
+                    std::string(i < 1000 ? "<angle>1</angle>" : "<angle>-0.5</angle>") +
+                    "</waypoint>\n";
+    }
+    auto path = WriteTrack(contents + "</track>\n");
+
+    auto cache = boost::filesystem::temp_directory_path() /
+                 boost::filesystem::unique_path("cache-%%%%%%%%");
+    boost::filesystem::create_directory(cache);
+    const auto cache_path = Config::inst().GetOption<std::string>("track_cache_path");
+    Config::inst().SetParameter("track_cache_path", cache.string() + "/");
+
+    const Vector<2, false> start = {{500.0, 500.0}};
+    HingeModel built, cached, reference;
+    DataReader::ReadTORCSTrackCached(path, built, start);
+    BOOST_CHECK_EQUAL(std::distance(boost::filesystem::directory_iterator(cache),
+                                    boost::filesystem::directory_iterator()),
+                      1);
+    DataReader::ReadTORCSTrackCached(path, cached, start);
+    DataReader::ReadTORCSTrack(path, reference, start);
+
+    RacingLine from_cache, from_track;
+    cached.Snapshot(from_cache);
+    reference.Snapshot(from_track);
+    BOOST_REQUIRE_GT(from_track.GetHingeCount(), 10);
+    BOOST_CHECK(from_cache.forward == from_track.forward);
+    BOOST_CHECK(from_cache.position_x == from_track.position_x);
+    BOOST_CHECK(from_cache.position_y == from_track.position_y);
+    BOOST_CHECK(from_cache.crossposition_vector_x == from_track.crossposition_vector_x);
+    BOOST_CHECK(from_cache.crossposition_vector_y == from_track.crossposition_vector_y);
+
+    // another start point gets its own geometry
+    HingeModel moved;
+    DataReader::ReadTORCSTrackCached(path, moved, Vector<2, false>({{0.0, 0.0}}));
+    BOOST_CHECK_EQUAL(std::distance(boost::filesystem::directory_iterator(cache),
+                                    boost::filesystem::directory_iterator()),
+                      2);
+
+    Config::inst().SetParameter("track_cache_path", cache_path);
+    boost::filesystem::remove_all(cache);
+    boost::filesystem::remove(path);
+};
+
+BOOST_AUTO_TEST_CASE(UnwritableTrackCache)
+{
+    std::string contents = "<track>\n";
+    for (int i = 0; i < 500; i++)
+        contents += "<waypoint><forward>1.0</forward><left>6</left><right>5</right>"
+                    "<angle>1</angle></waypoint>\n";
+    auto path = WriteTrack(contents + "</track>\n");
+
+    // a file where the cache directory should be can't be written into, not even as
+    // root
+    auto blocker = WriteTrack("");
+    const auto cache_path = Config::inst().GetOption<std::string>("track_cache_path");
+    Config::inst().SetParameter("track_cache_path", blocker + "/");
+
+    const Vector<2, false> start = {{500.0, 500.0}};
+    HingeModel cached, reference;
+    BOOST_CHECK_NO_THROW(DataReader::ReadTORCSTrackCached(path, cached, start));
+    DataReader::ReadTORCSTrack(path, reference, start);
+
+    BOOST_REQUIRE_GT(reference.GetHingeCount(), 10);
+    BOOST_CHECK(cached.GetForwards() == reference.GetForwards());
+
+    Config::inst().SetParameter("track_cache_path", cache_path);
+    boost::filesystem::remove(blocker);
+    boost::filesystem::remove(path);
+};
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "data_reader.h"
+#include <boost/filesystem.hpp>
+#include <fstream>
+#include <string>
+
+// Writes contents to a new temporary file and returns its path.
+inline std::string WriteTrack(const std::string &contents)
+{
+    auto path = boost::filesystem::temp_directory_path() /
+                boost::filesystem::unique_path("track-%%%%%%%%.xml");
+    std::ofstream(path.string()) << contents;
+    return path.string();
+}
+
+// A 400 m long arc of constant width and curvature.
+inline Track ReadArc()
+{
+    std::string contents = "<track>\n";
+    for (int i = 0; i < 400; i++)
+        contents += "<waypoint><forward>1.0</forward><left>6</left><right>6</right>"
+                    "<angle>0.5</angle></waypoint>\n";
+
+    auto path = WriteTrack(contents + "</track>\n");
+    Track track = DataReader::ParseTORCSTrack(path);
+    boost::filesystem::remove(path);
+    return track;
+}
@@ -0,0 +1,117 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE "Track parser tests"
+
+#include "exceptions.h"
+#include "track_file.h"
+#include "track_fixtures.h"
+#include "track_parser.h"
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+#include <fstream>
+
+BOOST_AUTO_TEST_CASE(ParsesWaypointsAcrossChunks)
+{
+    // long enough for waypoints to straddle the chunk boundaries
+    const int waypoints_n = 3000;
+    std::string contents = "<?xml version=\"1.0\"?>\n<!-- a <comment> -->\n<track>\n";
+    for (int i = 0; i < waypoints_n; i++)
+    {
+        contents += "\t<waypoint>\n\t\t<forward>" + std::to_string(i) +
+                    ".25</forward>\n\t\t<left> 6.5 </left>\n\t\t<right>-" +
+                    std::to_string(i % 7) + "</right>\n\t\t<speed>12</speed>\n" +
+                    "\t\t<angle>+0.125</angle>\n\t</waypoint>\n";
+    }
+    contents += "\t<waypoint><forward/><angle>1e-3</angle></waypoint>\n</track>\n";
+    BOOST_REQUIRE_GT(contents.size(), 2 * TrackParser::CHUNK);
+
+    auto path = WriteTrack(contents);
+    TrackParser parser(path);
+    TrackWaypoint waypoint;
+    for (int i = 0; i < waypoints_n; i++)
+    {
+        BOOST_REQUIRE(parser.Next(waypoint));
+        BOOST_CHECK_EQUAL(waypoint.forward, i + 0.25f);
+        BOOST_CHECK_EQUAL(waypoint.left, 6.5f);
+        BOOST_CHECK_EQUAL(waypoint.right, -float(i % 7));
+        BOOST_CHECK_EQUAL(waypoint.angle, 0.125f);
+    }
+
+    // missing fields read as zero
+    BOOST_REQUIRE(parser.Next(waypoint));
+    BOOST_CHECK_EQUAL(waypoint.forward, 0.0f);
+    BOOST_CHECK_EQUAL(waypoint.angle, float(1e-3));
+    BOOST_CHECK_EQUAL(waypoint.right, 0.0f);
+
+    BOOST_CHECK(!parser.Next(waypoint));
+    BOOST_CHECK(!parser.Next(waypoint));
+    boost::filesystem::remove(path);
+};
+
+BOOST_AUTO_TEST_CASE(RejectsMalformedTracks)
+{
+    for (std::string contents :
+         {"<track><waypoint><forward>1.0</forward>", "<track><corner/></track>",
+          "<track><waypoint><left>wide</left></waypoint></track>",
+          "<waypoint><forward>1.0</forward></waypoint>"})
+    {
+        auto path = WriteTrack(contents);
+        TrackParser parser(path);
+        TrackWaypoint waypoint;
+        BOOST_CHECK_THROW(while (parser.Next(waypoint)){}, Exception);
+        boost::filesystem::remove(path);
+    }
+
+    BOOST_CHECK_THROW(TrackParser("/nonexistent/track.xml"), Exception);
+};
+
+BOOST_AUTO_TEST_CASE(TrackFileRoundTrip)
+{
+    std::vector<TrackWaypoint> track;
+    for (int i = 0; i < 1000; i++)
+        track.push_back({i * 0.5f, 0.01f * (i % 13), 5.0f + i % 3, -4.0f - i % 5});
+
+    auto path = (boost::filesystem::temp_directory_path() /
+                 boost::filesystem::unique_path("track-%%%%%%%%.track"))
+                    .string();
+    TrackFile::Write(path, track);
+    BOOST_REQUIRE(TrackFile::IsTrackFile(path));
+
+    {
+        TrackFile file(path);
+        BOOST_REQUIRE_EQUAL(file.GetWaypointCount(), track.size());
+        for (size_t i = 0; i < track.size(); i++)
+        {
+            auto waypoint = file.GetWaypoint(i);
+            BOOST_CHECK_EQUAL(waypoint.forward, track[i].forward);
+            BOOST_CHECK_EQUAL(waypoint.angle, track[i].angle);
+            BOOST_CHECK_EQUAL(waypoint.left, track[i].left);
+            BOOST_CHECK_EQUAL(waypoint.right, track[i].right);
+        }
+    }
+
+    // a file written with the other byte order is rejected before anything else is read
+    {
+        const uint32_t swapped = 0x04030201;
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(offsetof(TrackFile::Header, byte_order));
+        file.write(reinterpret_cast<const char *>(&swapped), sizeof(swapped));
+    }
+    BOOST_CHECK_THROW(TrackFile file(path), Exception);
+    TrackFile::Write(path, track);
+
+    // a flipped byte in the records fails the checksum
+    {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(sizeof(TrackFile::Header) + 100);
+        file.put(0x7f);
+    }
+    BOOST_CHECK_THROW(TrackFile file(path), Exception);
+
+    // XML tracks aren't mistaken for binary ones
+    auto xml_path = WriteTrack("<track></track>");
+    BOOST_CHECK(!TrackFile::IsTrackFile(xml_path));
+    BOOST_CHECK_THROW(TrackFile file(xml_path), Exception);
+
+    boost::filesystem::remove(path);
+    boost::filesystem::remove(xml_path);
+};
@@ -0,0 +1,83 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE "Track saver tests"
+
+#include "config.h"
+#include "data_reader.h"
+#include "track_fixtures.h"
+#include "track_parser.h"
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+#include <cmath>
+
+BOOST_AUTO_TEST_CASE(SavedTracksParseBack)
+{
+    auto path = WriteTrack("");
+    const int waypoints_n = 500;
+    const float tolerance = Config::inst().GetOption<float>("recording_tolerance");
+    Config::inst().SetParameter("recording_tolerance", 0.0f);
+    {
+        TrackSaver saver(path);
+        for (int i = 0; i < waypoints_n; i++)
+            saver.MarkWaypoint(1.5f, 6.25f + i, -4.0f, 0.001f * (i % 9), 30.0f);
+
+        // waypoints reach the file while recording
+        BOOST_CHECK_GT(boost::filesystem::file_size(path), 2 * TrackSaver::FLUSH_SIZE);
+    }
+
+    TrackParser parser(path);
+    TrackWaypoint waypoint;
+    for (int i = 0; i < waypoints_n; i++)
+    {
+        BOOST_REQUIRE(parser.Next(waypoint));
+        BOOST_CHECK_EQUAL(waypoint.forward, 1.5f);
+        BOOST_CHECK_EQUAL(waypoint.left, 6.25f + i);
+        BOOST_CHECK_EQUAL(waypoint.right, -4.0f);
+        BOOST_CHECK_SMALL(waypoint.angle - 0.001f * (i % 9), 1e-6f);
+    }
+    BOOST_CHECK(!parser.Next(waypoint));
+    Config::inst().SetParameter("recording_tolerance", tolerance);
+    boost::filesystem::remove(path);
+};
+
+BOOST_AUTO_TEST_CASE(DecimatedRecordingKeepsHinges)
+{
+    // straights and corners of varying radius, with the track narrowing in between
+    Track track;
+    for (int i = 0; i < 6000; i++)
+    {
+        const float angle = (i / 700) % 2 ? 2.0f * std::sin(i * 0.004f) : 0.0f;
+        track.push_back({0.3f + 0.1f * (i % 3), angle, 6.0f + (i / 1000) % 2,
+                         5.0f - 0.5f * std::sin(i * 0.01f)});
+    }
+
+    auto path = WriteTrack("");
+    {
+        TrackSaver saver(path);
+        for (const auto &waypoint : track)
+        {
+            saver.MarkWaypoint(waypoint.forward, waypoint.left, waypoint.right,
+                               waypoint.angle, 30.0f);
+        }
+    }
+    auto decimated = DataReader::ParseTORCSTrack(path);
+    BOOST_CHECK_LT(decimated.size(), track.size() / 5);
+
+    const Vector<2, false> start = {{500.0, 500.0}};
+    HingeModel full, reduced;
+    DataReader::BuildHingeModel(track, full, start);
+    DataReader::BuildHingeModel(decimated, reduced, start);
+
+    RacingLine full_line, reduced_line;
+    full.Snapshot(full_line);
+    reduced.Snapshot(reduced_line);
+    BOOST_REQUIRE_EQUAL(reduced_line.GetHingeCount(), full_line.GetHingeCount());
+    for (size_t i = 0; i < full_line.GetHingeCount(); i++)
+    {
+        BOOST_CHECK_SMALL(reduced_line.position_x[i] - full_line.position_x[i], 0.05);
+        BOOST_CHECK_SMALL(reduced_line.position_y[i] - full_line.position_y[i], 0.05);
+        // the distances are summed in single precision, from many more waypoints in full
+        BOOST_CHECK_CLOSE(reduced_line.forward[i], full_line.forward[i], 0.05);
+    }
+
+    boost::filesystem::remove(path);
+};
@@ -0,0 +1,136 @@
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "config.h"
+#include "data_reader.h"
+#include "hinge_model.h"
+#include "log.h"
+
+// Optimizes the bundled tracks in double precision, in float precision and in float
+// precision with double polishing, and reports the time taken and how far the final
+// scores are from the double ones. Options are taken from the command line like in the
+// demo application, e.g. --optimizer=lbfgs, the gradient backend is always analytic.
+// Steps marked with + ran out before the optimization converged.
+
+namespace
+{
+const std::vector<std::string> TRACKS = {"data/tracks/street.xml",
+                                         "data/tracks/etrack.xml",
+                                         "data/tracks/forza.xml"};
+
+// optimization steps allowed before giving up on convergence
+const int MAX_STEPS = 20000;
+
+// gradient evaluations timed on the initial state of every track
+const int KERNEL_RUNS = 200;
+
+struct Mode
+{
+    const char *name;
+    std::string precision;
+    bool polish;
+};
+
+struct Result
+{
+    size_t hinges;
+    double kernel_ms, optimization_s, score;
+    int steps;
+    bool converged, feasible;
+};
+
+Result Run(const Track &track, const Mode &mode, adept::Stack &stack)
+{
+    using Clock = std::chrono::steady_clock;
+
+    Config::inst().SetParameter("precision", mode.precision);
+    Config::inst().SetParameter("precision_polish", mode.polish);
+
+    HingeModel model;
+    DataReader::BuildHingeModel(track, model, Vector<2, false>({{0.0, 0.0}}));
+    model.EnforceLimits();
+
+    Result result;
+    result.hinges = model.GetHingeCount();
+    auto start = Clock::now();
+    for (int i = 0; i < KERNEL_RUNS; i++)
+        model.ComputeGradient(stack);
+    result.kernel_ms =
+        std::chrono::duration<double, std::milli>(Clock::now() - start).count() /
+        KERNEL_RUNS;
+
+    result.converged = false;
+    result.steps = 0;
+    start = Clock::now();
+    while (result.steps < MAX_STEPS && !result.converged)
+    {
+        result.converged = model.Optimize(stack);
+        result.steps++;
+    }
+    result.optimization_s = std::chrono::duration<double>(Clock::now() - start).count();
+
+    // the final state is always judged in double precision
+    Config::inst().SetParameter("precision", std::string("double"));
+    HingeModel reference;
+    DataReader::BuildHingeModel(track, reference, Vector<2, false>({{0.0, 0.0}}));
+    for (size_t i = 0; i < model.GetHingeCount(); i++)
+    {
+        reference.SetCrossposition(i, model.GetCrosspositions()[i]);
+        reference.SetSpeed(i, model.GetSpeeds()[i]);
+    }
+
+    result.score = reference.ComputeGradient(stack);
+    result.feasible = reference.IsFeasible();
+    return result;
+}
+}
+
+int main(int argc, char **argv)
+{
+    Config::inst().Load(argc, argv);
+    Config::inst().SetParameter("gradient_backend", std::string("analytic"));
+    LoggingSingleton::inst().SetConsoleVerbosity(false);
+
+    const std::vector<Mode> modes = {{"double", "double", false},
+                                     {"float", "float", false},
+                                     {"float+polish", "float", true}};
+
+    adept::Stack stack;
+
+    // the models log every step, so the table is printed once they're all done
+    std::vector<std::string> rows;
+    char row[256];
+
+    for (const auto &track_path : TRACKS)
+    {
+        auto track = DataReader::ParseTORCSTrack(track_path);
+
+        double reference_score = 0.0;
+        for (const auto &mode : modes)
+        {
+            auto result = Run(track, mode, stack);
+            if (&mode == &modes.front())
+                reference_score = result.score;
+
+            std::snprintf(row, sizeof(row),
+                          "%-24s %-13s %8zu %10.4f %6d%s %10.3f %12.6f %9.4f%%%s",
+                          track_path.c_str(), mode.name, result.hinges,
+                          result.kernel_ms, result.steps, result.converged ? " " : "+",
+                          result.optimization_s, result.score,
+                          100.0 * (result.score - reference_score) /
+                              std::abs(reference_score),
+                          result.feasible ? "" : " infeasible");
+            rows.push_back(row);
+        }
+    }
+
+    std::printf("%-24s %-13s %8s %10s %7s %10s %12s %10s\n", "track", "mode", "hinges",
+                "kernel ms", "steps", "time s", "score", "deviation");
+    for (const auto &line : rows)
+        std::printf("%s\n", line.c_str());
+
+    return 0;
+}
@@ -0,0 +1,31 @@
+#include <cstdio>
+
+#include "data_reader.h"
+#include "exceptions.h"
+#include "track_file.h"
+
+// Converts a TORCS XML track into a binary track file, which loads without parsing.
+// Usage: track_converter <track.xml> <output>
+
+int main(int argc, char **argv)
+{
+    if (argc != 3)
+    {
+        std::fprintf(stderr, "Usage: %s <track.xml> <output>\n", argv[0]);
+        return 1;
+    }
+
+    try
+    {
+        auto track = DataReader::ParseTORCSTrack(argv[1]);
+        TrackFile::Write(argv[2], track);
+        std::printf("%zu waypoints written to %s\n", track.size(), argv[2]);
+    }
+    catch (const Exception &e)
+    {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+
+    return 0;
+}